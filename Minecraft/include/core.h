@@ -30,7 +30,9 @@
 #include <string>
 #include <string_view>
 #include <thread>
+#include <chrono>
 #include <mutex>
+#include <shared_mutex>
 #include <random>
 #include <future>
 #include <queue>
@@ -13,6 +13,9 @@ namespace Minecraft
 		void run();
 		void free();
 
+		// Runs without a window or GL context, then exits
+		void pregenerateWorld(const char* worldName, int radius);
+
 		void takeScreenshot(const char* filename = "", bool mustBeSquare = false);
 
 		Window& getWindow();
@@ -1,6 +1,7 @@
 #ifndef MINECRAFT_ECS_H
 #define MINECRAFT_ECS_H
 #include "core.h"
+#include "core/MemoryTracker.h"
 
 namespace Minecraft
 {
@@ -121,7 +122,7 @@ namespace Minecraft
 					if (!pool)
 					{
 						const int newNumPools = numPools + 1;
-						SparseSetPool* newPools = (SparseSetPool*)g_memory_realloc(pools, newNumPools * sizeof(SparseSetPool));
+						SparseSetPool* newPools = (SparseSetPool*)MemoryTracker::reallocate(MemoryTag::Ecs, pools, newNumPools * sizeof(SparseSetPool));
 						if (!newPools)
 						{
 							g_logger_error("Failed to allocate memory for new sparse set pool for component '%d'", componentId);
@@ -138,13 +139,13 @@ namespace Minecraft
 					if (nextIndex >= maxNumComponents)
 					{
 						int newMaxNumComponents = maxNumComponents * 2;
-						char* newComponentMemory = (char*)g_memory_realloc(data, componentSize * newMaxNumComponents);
-						EntityIndex* newEntityMemory = (EntityIndex*)g_memory_realloc(entities, sizeof(EntityIndex) * newMaxNumComponents);
+						char* newComponentMemory = (char*)MemoryTracker::reallocate(MemoryTag::Ecs, data, componentSize * newMaxNumComponents);
+						EntityIndex* newEntityMemory = (EntityIndex*)MemoryTracker::reallocate(MemoryTag::Ecs, entities, sizeof(EntityIndex) * newMaxNumComponents);
 						if (!newComponentMemory || !newEntityMemory)
 						{
 							// Just free both of the reallocs if it ever fails
-							g_memory_free(newComponentMemory);
-							g_memory_free(newEntityMemory);
+							MemoryTracker::free(MemoryTag::Ecs, newComponentMemory);
+							MemoryTracker::free(MemoryTag::Ecs, newEntityMemory);
 							g_logger_error("Failed to allocate new memory for component pool or entities for component '%d'", componentId);
 							return;
 						}
@@ -224,14 +225,14 @@ namespace Minecraft
 					componentSize = sizeof(T);
 
 					numPools = 1;
-					pools = (SparseSetPool*)g_memory_allocate(numPools * sizeof(SparseSetPool));
+					pools = (SparseSetPool*)MemoryTracker::allocate(MemoryTag::Ecs, numPools * sizeof(SparseSetPool));
 					pools[0].init();
 					pools[0].startIndex = getPoolAlignedIndex(startIndex);
 
 					numComponents = 0;
 					maxNumComponents = Internal::sparseSetPoolSize;
-					data = (char*)g_memory_allocate(componentSize * maxNumComponents);
-					entities = (EntityIndex*)g_memory_allocate(sizeof(EntityIndex) * maxNumComponents);
+					data = (char*)MemoryTracker::allocate(MemoryTag::Ecs, componentSize * maxNumComponents);
+					entities = (EntityIndex*)MemoryTracker::allocate(MemoryTag::Ecs, sizeof(EntityIndex) * maxNumComponents);
 				}
 
 				template<typename T>
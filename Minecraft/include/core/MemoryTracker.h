@@ -0,0 +1,47 @@
+#ifndef MINECRAFT_MEMORY_TRACKER_H
+#define MINECRAFT_MEMORY_TRACKER_H
+#include "core.h"
+
+namespace Minecraft
+{
+	enum class MemoryTag : uint8
+	{
+		ChunkBlocks,
+		SubChunkVertices,
+		Network,
+		Ecs,
+		Textures,
+		Fonts,
+		Length
+	};
+
+	// Keeps a running total of how much memory each subsystem is holding on to, along with the most it
+	// has ever held. Heap memory goes through allocate and free so the sizes can't get out of sync.
+	// Memory that lives somewhere else, like GPU buffers, is reported with add and remove.
+	//
+	// A budget of 0 means there's no limit. Going over a budget never fails an allocation, it's up to
+	// each subsystem to check and back off.
+	namespace MemoryTracker
+	{
+		void* allocate(MemoryTag tag, size_t numBytes);
+		// Same as realloc. Passing nullptr allocates, and on failure the old memory is left alone
+		void* reallocate(MemoryTag tag, void* memory, size_t numBytes);
+		void free(MemoryTag tag, void* memory);
+
+		void add(MemoryTag tag, size_t numBytes);
+		void remove(MemoryTag tag, size_t numBytes);
+
+		size_t getCurrent(MemoryTag tag);
+		size_t getPeak(MemoryTag tag);
+
+		void setBudget(MemoryTag tag, size_t numBytes);
+		size_t getBudget(MemoryTag tag);
+		// True if adding numBytes more would go over the budget
+		bool isOverBudget(MemoryTag tag, size_t numBytes = 0);
+
+		const char* getName(MemoryTag tag);
+		void logUsage();
+	}
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef MINECRAFT_MPSC_QUEUE_H
+#define MINECRAFT_MPSC_QUEUE_H
+#include "core.h"
+
+namespace Minecraft
+{
+	// Bounded lock-free queue that any number of threads can push to, but only one thread can pop from.
+	// Every cell has a sequence number that tells producers when it's free and the consumer when it's
+	// been written, so a slow producer never lets the consumer read a half written cell.
+	// Producers wait while the queue is full, so it has to be sized for the most the consumer can fall behind.
+	template<typename T>
+	class MpscQueue
+	{
+	public:
+		MpscQueue(uint32 capacity)
+		{
+			g_logger_assert(capacity > 0 && (capacity & (capacity - 1)) == 0, "MpscQueue capacity must be a power of two.");
+			this->capacity = capacity;
+			cells = new Cell[capacity];
+			for (uint32 i = 0; i < capacity; i++)
+			{
+				cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+			head.store(0, std::memory_order_relaxed);
+			tail = 0;
+		}
+
+		~MpscQueue()
+		{
+			delete[] cells;
+		}
+
+		MpscQueue(const MpscQueue&) = delete;
+		MpscQueue& operator=(const MpscQueue&) = delete;
+
+		bool tryPush(const T& value)
+		{
+			uint32 position = head.load(std::memory_order_relaxed);
+			while (true)
+			{
+				Cell& cell = cells[position & (capacity - 1)];
+				uint32 sequence = cell.sequence.load(std::memory_order_acquire);
+				int32 difference = (int32)sequence - (int32)position;
+				if (difference == 0)
+				{
+					if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						cell.value = value;
+						cell.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (difference < 0)
+				{
+					// The consumer hasn't caught up yet
+					return false;
+				}
+				else
+				{
+					position = head.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		void push(const T& value)
+		{
+			while (!tryPush(value))
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		// Must only ever be called from the consumer thread
+		bool tryPop(T& outValue)
+		{
+			Cell& cell = cells[tail & (capacity - 1)];
+			uint32 sequence = cell.sequence.load(std::memory_order_acquire);
+			if ((int32)sequence - (int32)(tail + 1) < 0)
+			{
+				return false;
+			}
+
+			outValue = cell.value;
+			cell.sequence.store(tail + capacity, std::memory_order_release);
+			tail++;
+			return true;
+		}
+
+	private:
+		struct Cell
+		{
+			std::atomic<uint32> sequence;
+			T value;
+		};
+
+		Cell* cells;
+		uint32 capacity;
+		std::atomic<uint32> head;
+		uint32 tail;
+	};
+}
+
+#endif
\ No newline at end of file
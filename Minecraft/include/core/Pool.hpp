@@ -1,80 +1,167 @@
 #ifndef MINECRAFT_POOL_H
 #define MINECRAFT_POOL_H
 #include "core.h"
+#include "core/VirtualMemory.h"
 
 namespace Minecraft
 {
-	template<typename T, const int NumPools>
+	// Fixed number of equally sized pools. Free pools are kept on a lock-free stack of indices, so
+	// getting and freeing a pool is O(1) and never blocks, no matter how many threads are meshing.
+	// The number of pools is picked at runtime, but can't change once the pool exists.
+	//
+	// Page backed pools come straight from the OS with every pool starting on a page, so a pool that
+	// isn't in use can give its memory back with releasePool. Pages nobody has touched yet cost nothing.
+	template<typename T>
 	class Pool
 	{
 	public:
 		Pool()
 		{
 			data = nullptr;
-			dataLength = 0;
 			_poolSize = 0;
-			std::lock_guard<std::mutex> lock(bitsetMtx);
-			poolsBeingUsed.reset();
+			poolStride = 0;
+			numPools = 0;
+			isPageBacked = false;
+			nextFree = nullptr;
+			poolsBeingUsed = nullptr;
+			resetFreeList();
 		}
 
-		Pool(uint32 poolSize)
+		Pool(uint32 poolSize, uint32 poolCount, bool pageBacked = false)
 		{
-			data = (T*)g_memory_allocate(sizeof(T) * poolSize * NumPools);
-			dataLength = NumPools * poolSize;
+			poolStride = sizeof(T) * poolSize;
+			if (pageBacked)
+			{
+				size_t pageSize = VirtualMemory::getPageSize();
+				poolStride = (poolStride + pageSize - 1) & ~(uint64)(pageSize - 1);
+				data = (T*)VirtualMemory::allocate(poolStride * poolCount);
+				g_logger_assert(data != nullptr, "Failed to reserve %llu bytes for a page backed pool.", (unsigned long long)(poolStride * poolCount));
+			}
+			else
+			{
+				data = (T*)g_memory_allocate(poolStride * poolCount);
+			}
+			isPageBacked = pageBacked;
 			_poolSize = poolSize;
-			std::lock_guard<std::mutex> lock(bitsetMtx);
-			poolsBeingUsed.reset();
+			numPools = poolCount;
+			nextFree = new std::atomic<uint32>[numPools];
+			poolsBeingUsed = new std::atomic<bool>[numPools];
+			resetFreeList();
 		}
 
 		~Pool()
 		{
 			if (data != nullptr)
 			{
-				g_memory_free(data);
+				if (isPageBacked)
+				{
+					VirtualMemory::free(data, poolStride * numPools);
+				}
+				else
+				{
+					g_memory_free(data);
+				}
 				data = nullptr;
-				dataLength = 0;
 				_poolSize = 0;
+				poolStride = 0;
 			}
+
+			delete[] nextFree;
+			delete[] poolsBeingUsed;
+			nextFree = nullptr;
+			poolsBeingUsed = nullptr;
+			numPools = 0;
 		}
 
+		Pool(const Pool&) = delete;
+		Pool& operator=(const Pool&) = delete;
+
 		T* operator[](int poolIndex)
 		{
-			g_logger_assert(poolIndex >= 0 && poolIndex < NumPools, "Pool index '%d' out of bounds in pool with size '%d'.", poolIndex, NumPools);
-			return data + (_poolSize * poolIndex);
+			g_logger_assert(poolIndex >= 0 && (uint32)poolIndex < numPools, "Pool index '%d' out of bounds in pool with size '%d'.", poolIndex, numPools);
+			return getPool((uint32)poolIndex);
 		}
 
 		const T* operator[](int poolIndex) const
 		{
-			g_logger_assert(poolIndex >= 0 && poolIndex < NumPools, "Pool index '%d' out of bounds in pool with size '%d'.", poolIndex, NumPools);
-			return data+ (_poolSize * poolIndex);
+			g_logger_assert(poolIndex >= 0 && (uint32)poolIndex < numPools, "Pool index '%d' out of bounds in pool with size '%d'.", poolIndex, numPools);
+			return (const T*)((const uint8*)data + poolStride * poolIndex);
+		}
+
+		// The index of a pool handed out by getNewPool, for freePool
+		uint32 getPoolIndex(const T* pool) const
+		{
+			uint64 offset = (uint64)((const uint8*)pool - (const uint8*)data);
+			g_logger_assert(offset % poolStride == 0 && offset / poolStride < numPools, "Pointer is not the start of a pool in this pool.");
+			return (uint32)(offset / poolStride);
 		}
 
 		T* getNewPool()
 		{
-			std::lock_guard<std::mutex> lock(bitsetMtx);
-			for (int i = 0; i < poolsBeingUsed.size(); i++)
+			T* pool = tryGetNewPool();
+			g_logger_assert(pool != nullptr, "Ran out of pools!");
+			return pool;
+		}
+
+		// Returns nullptr instead of asserting when every pool is in use
+		T* tryGetNewPool()
+		{
+			uint64 head = freeHead.load(std::memory_order_acquire);
+			while (true)
 			{
-				if (!poolsBeingUsed.test(i))
+				uint32 poolIndex = getIndex(head);
+				if (poolIndex == EmptyIndex)
 				{
-					poolsBeingUsed.set(i, true);
-					return data + (_poolSize * i);
+					return nullptr;
 				}
-			}
 
-			g_logger_assert(false, "Ran out of pools!");
-			return nullptr;
+				// The tag changes on every push and pop, so if another thread popped this index and pushed
+				// it back in the meantime the exchange fails instead of linking in a stale next index
+				uint64 newHead = makeHead(nextFree[poolIndex].load(std::memory_order_relaxed), getTag(head) + 1);
+				if (freeHead.compare_exchange_weak(head, newHead, std::memory_order_acq_rel, std::memory_order_acquire))
+				{
+					poolsBeingUsed[poolIndex].store(true, std::memory_order_relaxed);
+					return getPool(poolIndex);
+				}
+			}
 		}
 
 		void freePool(uint32 poolIndex)
 		{
-			g_logger_assert(poolIndex >= 0 && poolIndex < NumPools, "Pool index '%d' out of bounds in pool with size '%d'.", poolIndex, NumPools);
-			std::lock_guard<std::mutex> lock(bitsetMtx);
-			poolsBeingUsed.set(poolIndex, false);
+			g_logger_assert(poolIndex >= 0 && (uint32)poolIndex < numPools, "Pool index '%d' out of bounds in pool with size '%d'.", poolIndex, numPools);
+			if (!poolsBeingUsed[poolIndex].exchange(false, std::memory_order_relaxed))
+			{
+				// Already free, pushing it again would put it on the stack twice
+				return;
+			}
+
+			uint64 head = freeHead.load(std::memory_order_relaxed);
+			while (true)
+			{
+				nextFree[poolIndex].store(getIndex(head), std::memory_order_relaxed);
+				uint64 newHead = makeHead(poolIndex, getTag(head) + 1);
+				if (freeHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed))
+				{
+					return;
+				}
+			}
+		}
+
+		// Hands the pool's pages back to the OS. It reads as zeros afterwards, so anything that lived
+		// there has to be destroyed first and constructed again when the pool is reused. Does nothing
+		// for pools that aren't page backed
+		void releasePool(uint32 poolIndex)
+		{
+			g_logger_assert(poolIndex < numPools, "Pool index '%d' out of bounds in pool with size '%d'.", poolIndex, numPools);
+			if (isPageBacked)
+			{
+				VirtualMemory::release(getPool(poolIndex), poolStride);
+			}
 		}
 
 		uint32 size() const
 		{
-			return NumPools;
+			return numPools;
 		}
 
 		uint32 poolSize() const
@@ -84,23 +171,60 @@ namespace Minecraft
 
 		uint64 totalSize() const
 		{
-			return dataLength * sizeof(T);
+			return poolStride * numPools;
 		}
 
-		bool empty()
+		bool empty() const
 		{
-			std::lock_guard<std::mutex> lock(bitsetMtx);
-			return poolsBeingUsed.all();
+			return getIndex(freeHead.load(std::memory_order_acquire)) == EmptyIndex;
 		}
 
 	private:
-		std::mutex bitsetMtx;
-		std::bitset<NumPools> poolsBeingUsed;
-		uint64 dataLength;
+		static const uint32 EmptyIndex = UINT32_MAX;
+
+		// The head of the free stack is the top pool's index in the low 32 bits and an ABA tag in the high 32 bits
+		static uint64 makeHead(uint32 poolIndex, uint32 tag)
+		{
+			return ((uint64)tag << 32) | (uint64)poolIndex;
+		}
+
+		static uint32 getIndex(uint64 head)
+		{
+			return (uint32)(head & 0xFFFFFFFF);
+		}
+
+		static uint32 getTag(uint64 head)
+		{
+			return (uint32)(head >> 32);
+		}
+
+		T* getPool(uint32 poolIndex)
+		{
+			return (T*)((uint8*)data + poolStride * poolIndex);
+		}
+
+		void resetFreeList()
+		{
+			// Pool 0 starts on top so pools are handed out in order, like they used to be
+			for (uint32 i = 0; i < numPools; i++)
+			{
+				nextFree[i].store(i + 1 < numPools ? i + 1 : EmptyIndex, std::memory_order_relaxed);
+				poolsBeingUsed[i].store(false, std::memory_order_relaxed);
+			}
+			freeHead.store(makeHead(numPools > 0 ? 0 : EmptyIndex, 0), std::memory_order_release);
+		}
+
+		std::atomic<uint64> freeHead;
+		std::atomic<uint32>* nextFree;
+		std::atomic<bool>* poolsBeingUsed;
+		// Bytes from the start of one pool to the next. Page backed pools round this up to a whole page
+		uint64 poolStride;
 		uint32 _poolSize;
+		uint32 numPools;
+		bool isPageBacked;
 		T* data;
 	};
 
 }
 
-#endif 
\ No newline at end of file
+#endif
\ No newline at end of file
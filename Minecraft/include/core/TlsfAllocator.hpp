@@ -0,0 +1,350 @@
+#ifndef MINECRAFT_TLSF_ALLOCATOR_H
+#define MINECRAFT_TLSF_ALLOCATOR_H
+#include "core.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Minecraft
+{
+	// Two-level segregated fit allocator over a range of [0, capacity) units. It never touches the
+	// memory it hands out, it only keeps track of which offsets are in use, so it works for GPU buffers
+	// just as well as CPU ones. Allocating and freeing are O(1): free ranges are binned by the position
+	// of their highest bit and 16 linear steps below that, and two bitmaps find the smallest non-empty
+	// bin that's big enough. Freed ranges are merged with free neighbors right away.
+	//
+	// This isn't thread safe, callers have to lock around it.
+	class TlsfAllocator
+	{
+	public:
+		static const uint32 InvalidHandle = UINT32_MAX;
+
+		struct Allocation
+		{
+			uint32 offset;
+			uint32 size;
+			// Pass this back to free
+			uint32 handle;
+		};
+
+		TlsfAllocator()
+		{
+			init(0);
+		}
+
+		TlsfAllocator(uint32 capacity)
+		{
+			init(capacity);
+		}
+
+		// Forgets every allocation and starts over with one free range covering everything
+		void init(uint32 capacity)
+		{
+			blocks.clear();
+			unusedBlocks.clear();
+			firstLevelBitmap = 0;
+			for (int fl = 0; fl < FirstLevelCount; fl++)
+			{
+				secondLevelBitmaps[fl] = 0;
+				for (int sl = 0; sl < SecondLevelCount; sl++)
+				{
+					freeHeads[fl][sl] = InvalidHandle;
+				}
+			}
+			_capacity = capacity;
+			_used = 0;
+
+			if (capacity > 0)
+			{
+				uint32 block = newBlock();
+				blocks[block].offset = 0;
+				blocks[block].size = capacity;
+				insertFreeBlock(block);
+			}
+		}
+
+		// Returns false if there's no free range of at least size units
+		bool allocate(uint32 size, Allocation& outAllocation)
+		{
+			if (size == 0 || size > _capacity - _used)
+			{
+				return false;
+			}
+
+			int fl, sl;
+			uint32 block = InvalidHandle;
+			if (mappingSearch(size, fl, sl))
+			{
+				block = findFreeBlock(fl, sl);
+			}
+
+			if (block == InvalidHandle)
+			{
+				// The search skips the bin this size falls in, since not every block in it is big enough.
+				// When nothing bigger is left, one of those might still fit
+				mappingInsert(size, fl, sl);
+				for (block = freeHeads[fl][sl]; block != InvalidHandle; block = blocks[block].nextFree)
+				{
+					if (blocks[block].size >= size)
+					{
+						break;
+					}
+				}
+
+				if (block == InvalidHandle)
+				{
+					return false;
+				}
+			}
+			removeFreeBlock(block);
+
+			// Give whatever is left back to the free lists
+			if (blocks[block].size > size)
+			{
+				uint32 remainder = newBlock();
+				blocks[remainder].offset = blocks[block].offset + size;
+				blocks[remainder].size = blocks[block].size - size;
+				blocks[remainder].prevPhysical = block;
+				blocks[remainder].nextPhysical = blocks[block].nextPhysical;
+				if (blocks[remainder].nextPhysical != InvalidHandle)
+				{
+					blocks[blocks[remainder].nextPhysical].prevPhysical = remainder;
+				}
+				blocks[block].nextPhysical = remainder;
+				blocks[block].size = size;
+				insertFreeBlock(remainder);
+			}
+
+			blocks[block].isFree = false;
+			_used += size;
+
+			outAllocation.offset = blocks[block].offset;
+			outAllocation.size = size;
+			outAllocation.handle = block;
+			return true;
+		}
+
+		void free(uint32 handle)
+		{
+			g_logger_assert(handle < (uint32)blocks.size() && !blocks[handle].isFree, "Freed invalid or already free allocation '%u'.", handle);
+			_used -= blocks[handle].size;
+
+			uint32 next = blocks[handle].nextPhysical;
+			if (next != InvalidHandle && blocks[next].isFree)
+			{
+				removeFreeBlock(next);
+				absorbNext(handle);
+			}
+
+			uint32 prev = blocks[handle].prevPhysical;
+			if (prev != InvalidHandle && blocks[prev].isFree)
+			{
+				removeFreeBlock(prev);
+				absorbNext(prev);
+				handle = prev;
+			}
+
+			insertFreeBlock(handle);
+		}
+
+		uint32 capacity() const
+		{
+			return _capacity;
+		}
+
+		uint32 used() const
+		{
+			return _used;
+		}
+
+	private:
+		static const int SecondLevelLog2 = 4;
+		static const int SecondLevelCount = 1 << SecondLevelLog2;
+		// Sizes below this all go in the first bin, one second level bin per size
+		static const uint32 SmallSize = 1 << SecondLevelLog2;
+		static const int FirstLevelCount = 32 - SecondLevelLog2 + 1;
+
+		struct Block
+		{
+			uint32 offset;
+			uint32 size;
+			uint32 prevPhysical;
+			uint32 nextPhysical;
+			uint32 prevFree;
+			uint32 nextFree;
+			bool isFree;
+		};
+
+		static int findLowestBit(uint32 value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, value);
+			return (int)index;
+#else
+			return __builtin_ctz(value);
+#endif
+		}
+
+		static int findHighestBit(uint32 value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanReverse(&index, value);
+			return (int)index;
+#else
+			return 31 - __builtin_clz(value);
+#endif
+		}
+
+		// The bin a free block of this size goes in
+		static void mappingInsert(uint32 size, int& outFl, int& outSl)
+		{
+			if (size < SmallSize)
+			{
+				outFl = 0;
+				outSl = (int)size;
+				return;
+			}
+
+			int highestBit = findHighestBit(size);
+			outSl = (int)((size >> (highestBit - SecondLevelLog2)) ^ SmallSize);
+			outFl = highestBit - (SecondLevelLog2 - 1);
+		}
+
+		// The first bin where every block is at least this big, so the search never has to look inside a bin
+		static bool mappingSearch(uint32 size, int& outFl, int& outSl)
+		{
+			uint64 roundedSize = size;
+			if (size >= SmallSize)
+			{
+				roundedSize += ((uint64)1 << (findHighestBit(size) - SecondLevelLog2)) - 1;
+			}
+
+			if (roundedSize > UINT32_MAX)
+			{
+				return false;
+			}
+
+			mappingInsert((uint32)roundedSize, outFl, outSl);
+			return outFl < FirstLevelCount;
+		}
+
+		uint32 findFreeBlock(int fl, int sl) const
+		{
+			uint32 slMap = secondLevelBitmaps[fl] & (~0u << sl);
+			if (!slMap)
+			{
+				uint32 flMap = fl + 1 < 32 ? firstLevelBitmap & (~0u << (fl + 1)) : 0;
+				if (!flMap)
+				{
+					return InvalidHandle;
+				}
+
+				fl = findLowestBit(flMap);
+				slMap = secondLevelBitmaps[fl];
+			}
+
+			sl = findLowestBit(slMap);
+			return freeHeads[fl][sl];
+		}
+
+		void insertFreeBlock(uint32 block)
+		{
+			int fl, sl;
+			mappingInsert(blocks[block].size, fl, sl);
+
+			uint32 head = freeHeads[fl][sl];
+			blocks[block].isFree = true;
+			blocks[block].prevFree = InvalidHandle;
+			blocks[block].nextFree = head;
+			if (head != InvalidHandle)
+			{
+				blocks[head].prevFree = block;
+			}
+			freeHeads[fl][sl] = block;
+
+			firstLevelBitmap |= 1u << fl;
+			secondLevelBitmaps[fl] |= 1u << sl;
+		}
+
+		void removeFreeBlock(uint32 block)
+		{
+			int fl, sl;
+			mappingInsert(blocks[block].size, fl, sl);
+
+			uint32 prev = blocks[block].prevFree;
+			uint32 next = blocks[block].nextFree;
+			if (prev != InvalidHandle)
+			{
+				blocks[prev].nextFree = next;
+			}
+			if (next != InvalidHandle)
+			{
+				blocks[next].prevFree = prev;
+			}
+
+			if (freeHeads[fl][sl] == block)
+			{
+				freeHeads[fl][sl] = next;
+				if (next == InvalidHandle)
+				{
+					secondLevelBitmaps[fl] &= ~(1u << sl);
+					if (!secondLevelBitmaps[fl])
+					{
+						firstLevelBitmap &= ~(1u << fl);
+					}
+				}
+			}
+			blocks[block].isFree = false;
+		}
+
+		// Merges the block after this one into it. Neither may be on a free list
+		void absorbNext(uint32 block)
+		{
+			uint32 next = blocks[block].nextPhysical;
+			blocks[block].size += blocks[next].size;
+			blocks[block].nextPhysical = blocks[next].nextPhysical;
+			if (blocks[block].nextPhysical != InvalidHandle)
+			{
+				blocks[blocks[block].nextPhysical].prevPhysical = block;
+			}
+			unusedBlocks.push_back(next);
+		}
+
+		uint32 newBlock()
+		{
+			uint32 block;
+			if (!unusedBlocks.empty())
+			{
+				block = unusedBlocks.back();
+				unusedBlocks.pop_back();
+			}
+			else
+			{
+				block = (uint32)blocks.size();
+				blocks.emplace_back();
+			}
+
+			blocks[block].offset = 0;
+			blocks[block].size = 0;
+			blocks[block].prevPhysical = InvalidHandle;
+			blocks[block].nextPhysical = InvalidHandle;
+			blocks[block].prevFree = InvalidHandle;
+			blocks[block].nextFree = InvalidHandle;
+			blocks[block].isFree = false;
+			return block;
+		}
+
+		// Handles index into this, so blocks are never moved around. Merged away blocks get reused
+		std::vector<Block> blocks;
+		std::vector<uint32> unusedBlocks;
+		uint32 firstLevelBitmap;
+		uint32 secondLevelBitmaps[FirstLevelCount];
+		uint32 freeHeads[FirstLevelCount][SecondLevelCount];
+		uint32 _capacity;
+		uint32 _used;
+	};
+}
+
+#endif
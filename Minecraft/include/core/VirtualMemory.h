@@ -0,0 +1,23 @@
+#ifndef MINECRAFT_VIRTUAL_MEMORY_H
+#define MINECRAFT_VIRTUAL_MEMORY_H
+#include "core.h"
+
+namespace Minecraft
+{
+	// Big allocations straight from the OS. Unlike the heap, the pages can be handed back while the
+	// addresses stay reserved, and untouched pages never take up any physical memory at all
+	namespace VirtualMemory
+	{
+		size_t getPageSize();
+
+		// Zeroed memory aligned to a huge page, and marked as a huge page candidate where the OS supports it.
+		// Returns nullptr on failure
+		void* allocate(size_t numBytes);
+		void free(void* memory, size_t numBytes);
+
+		// Gives every page entirely inside the range back to the OS. They read as zero when they're touched again
+		void release(void* memory, size_t numBytes);
+	}
+}
+
+#endif
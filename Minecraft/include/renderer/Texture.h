@@ -80,6 +80,8 @@ namespace Minecraft
 		ByteFormat format;
 		ColorChannel swizzleFormat[4];
 		bool generateMipmap;
+		// What the texture takes up on the GPU, so destroy can take it back out of the memory tracker
+		size_t gpuBytes;
 
 		char* path;
 
@@ -132,6 +134,7 @@ namespace Minecraft
 
 		bool byteFormatIsInt(const Texture& texture);
 		bool byteFormatIsRgb(const Texture& texture);
+		uint32 getBytesPerPixel(ByteFormat format);
 
 		void generateFromFile(Texture& texture);
 		void generateEmptyTexture(Texture& texture);
@@ -11,7 +11,6 @@ namespace Minecraft
 		extern float lastFrameTime;
 		extern glm::vec3 playerPos;
 		extern glm::vec3 playerOrientation;
-		extern std::atomic<float> totalChunkRamUsed;
 		extern float totalChunkRamAvailable;
 		extern Block blockLookingAt;
 
@@ -11,6 +11,26 @@ namespace Minecraft
 			extern glm::vec4 clearColor;
 			extern const char* title;
 		}
+
+		namespace Chunks
+		{
+			// 0 means one thread per hardware thread, minus one for the main thread
+			extern uint32 numWorkerThreads;
+			// How much block data of recently unloaded chunks to keep around. 0 turns the cache off
+			extern uint32 chunkCacheMegabytes;
+			// Render distance in chunks. Use ChunkManager::setChunkRadius to change it while a world is loaded
+			extern uint32 chunkRadius;
+			// Merge neighboring opaque faces that look the same into bigger quads. Use ChunkManager::setGreedyMeshing
+			// to change it while a world is loaded
+			extern bool greedyMeshing;
+		}
+
+		namespace Memory
+		{
+			// 0 means no limit. Chunk loading waits for memory to free up instead of going over these
+			extern uint32 chunkBlockBudgetMegabytes;
+			extern uint32 subChunkVertexBudgetMegabytes;
+		}
 	}
 }
 
@@ -98,6 +98,19 @@ namespace Minecraft
 		const Texture* texture;
 	};
 
+	// The BlockFormat flags that get checked for every block and its neighbors, packed into one byte per id
+	enum class BlockProperty : uint8
+	{
+		Transparent = 1 << 0,
+		Solid = 1 << 1,
+		Blendable = 1 << 2,
+		LightSource = 1 << 3,
+		ColorTopByBiome = 1 << 4,
+		ColorSideByBiome = 1 << 5,
+		ColorBottomByBiome = 1 << 6,
+		ItemOnly = 1 << 7
+	};
+
 	namespace BlockMap
 	{
 		extern Block NULL_BLOCK;
@@ -118,6 +131,30 @@ namespace Minecraft
 		uint32 getTextureCoordinatesTextureId();
 
 		const std::vector<CraftingRecipe>& getAllCraftingRecipes();
+
+		// Covers every possible id so a lookup never has to be bounds checked. Ids that aren't loaded get the
+		// same properties as the null block, just like getBlock hands back the null block's format for them
+		extern uint8 blockProperties[UINT16_MAX + 1];
+
+		inline bool hasProperty(uint16 blockId, BlockProperty property)
+		{
+			return (blockProperties[blockId] & (uint8)property) != 0;
+		}
+	}
+
+	inline bool Block::isLightSource() const
+	{
+		return BlockMap::hasProperty(id, BlockProperty::LightSource);
+	}
+
+	inline bool Block::isTransparent() const
+	{
+		return BlockMap::hasProperty(id, BlockProperty::Transparent);
+	}
+
+	inline bool Block::isItemOnly() const
+	{
+		return BlockMap::hasProperty(id, BlockProperty::ItemOnly);
 	}
 }
 
@@ -4,7 +4,7 @@
 
 namespace Minecraft
 {
-	struct Block;
+	class ChunkData;
 
 	enum class ChunkState : uint8
 	{
@@ -16,13 +16,50 @@ namespace Minecraft
 		Loaded
 	};
 
+	// Each chunk moves through these in order. A chunk can only advance once all 8 of its
+	// neighbors have reached the stage it's currently in, since every stage after generation
+	// reads or writes across chunk borders
+	enum class ChunkStage : uint8
+	{
+		Empty,
+		Generated,
+		Decorated,
+		Lit,
+		Meshed
+	};
+
 	struct Chunk
 	{
-		Block* data;
+		ChunkData* data;
 		glm::ivec2 chunkCoords;
-		ChunkState state;
-		bool needsToGenerateDecorations;
-		bool needsToCalculateLighting;
+		// Unique to this chunk, set by the ChunkDirectory when it's inserted
+		uint32 generation;
+		// Written by the main thread and the I/O thread, read by every worker
+		std::atomic<ChunkState> state;
+		std::atomic<ChunkStage> stage;
+		// Set while the command for the next stage is queued or running. Guarded by the chunk mutex
+		bool stageQueued;
+		// One bit per CommandType that is sitting in a worker queue for this chunk
+		std::atomic<uint8> queuedCommands;
+		// Bumped by every mesh of this chunk
+		std::atomic<uint32> meshVersion;
+		// One bit per 16 block tall level that the next mesh of this chunk has to redo. Queued meshes
+		// add their levels here, so a mesh that gets merged into one already queued still gets done
+		std::atomic<uint16> levelsToMesh;
+		// Commands that are queued or running against this chunk. The chunk can't be erased while this,
+		// or the count of any of its neighbors, is above zero
+		std::atomic<uint32> pinCount;
+		// Set when the chunk came back from the chunk cache with its light, so lighting only has to
+		// spread it into the neighbors instead of starting over
+		bool hasCachedLight;
+		// When this chunk's decorations were generated, on the same counter the chunk cache is stamped
+		// with. Zero for chunks that were loaded. Guarded by the chunk mutex
+		uint32 decoratedSequence;
+
+		// Sub-chunks that are drawn for this chunk and, for each level, the oldest mesh that's still
+		// allowed to be. These are only ever touched by the main thread
+		std::vector<uint32> subChunkIndices;
+		uint32 retiredMeshVersions[16];
 
 		Chunk* topNeighbor;
 		Chunk* bottomNeighbor;
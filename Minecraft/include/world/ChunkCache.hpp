@@ -0,0 +1,126 @@
+#ifndef MINECRAFT_CHUNK_CACHE_H
+#define MINECRAFT_CHUNK_CACHE_H
+#include "core.h"
+#include "world/ChunkData.hpp"
+
+namespace Minecraft
+{
+	// Block data and light of chunks that were unloaded recently, so walking back over a chunk border
+	// doesn't have to read the chunk from disk and light it all over again. Everything in here has
+	// already been saved, so any entry can be dropped at any time. The least recently unloaded chunks
+	// go first once the cache is over its memory budget, or when the block pool runs dry.
+	//
+	// Only the main thread touches this.
+	class ChunkCache
+	{
+	public:
+		ChunkCache()
+		{
+			memoryUsed = 0;
+			memoryBudget = 0;
+		}
+
+		void setMemoryBudget(size_t bytes)
+		{
+			memoryBudget = bytes;
+		}
+
+		// Takes over the chunk's data. The sequence is handed back by take, so the caller can tell what
+		// changed around the chunk while it was cached. Anything that had to be dropped to make room,
+		// including this chunk if it doesn't fit at all, goes into evicted
+		void insert(const glm::ivec2& chunkCoords, ChunkData* data, uint32 sequence, std::vector<ChunkData*>& evicted)
+		{
+			ChunkData* oldData = take(chunkCoords);
+			if (oldData)
+			{
+				evicted.push_back(oldData);
+			}
+
+			size_t bytes = data->getMemoryUsed();
+			if (bytes > memoryBudget)
+			{
+				evicted.push_back(data);
+				return;
+			}
+
+			while (memoryUsed + bytes > memoryBudget)
+			{
+				evicted.push_back(evictOldest());
+			}
+
+			entries.push_front({ chunkCoords, data, bytes, sequence });
+			lookup[chunkCoords] = entries.begin();
+			memoryUsed += bytes;
+		}
+
+		// Removes the chunk from the cache and returns its data, or nullptr if it isn't cached
+		ChunkData* take(const glm::ivec2& chunkCoords, uint32* outSequence = nullptr)
+		{
+			auto iter = lookup.find(chunkCoords);
+			if (iter == lookup.end())
+			{
+				return nullptr;
+			}
+
+			ChunkData* data = iter->second->data;
+			if (outSequence)
+			{
+				*outSequence = iter->second->sequence;
+			}
+			memoryUsed -= iter->second->bytes;
+			entries.erase(iter->second);
+			lookup.erase(iter);
+			return data;
+		}
+
+		// Returns nullptr if the cache is empty
+		ChunkData* evictOldest()
+		{
+			if (entries.empty())
+			{
+				return nullptr;
+			}
+
+			return take(entries.back().chunkCoords);
+		}
+
+		// Hands back every cached chunk's data
+		void clear(std::vector<ChunkData*>& evicted)
+		{
+			for (const Entry& entry : entries)
+			{
+				evicted.push_back(entry.data);
+			}
+			entries.clear();
+			lookup.clear();
+			memoryUsed = 0;
+		}
+
+		uint32 size() const
+		{
+			return (uint32)entries.size();
+		}
+
+		size_t getMemoryUsed() const
+		{
+			return memoryUsed;
+		}
+
+	private:
+		struct Entry
+		{
+			glm::ivec2 chunkCoords;
+			ChunkData* data;
+			size_t bytes;
+			uint32 sequence;
+		};
+
+		// Most recently unloaded first
+		std::list<Entry> entries;
+		robin_hood::unordered_flat_map<glm::ivec2, std::list<Entry>::iterator> lookup;
+		size_t memoryUsed;
+		size_t memoryBudget;
+	};
+}
+
+#endif
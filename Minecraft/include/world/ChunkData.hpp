@@ -0,0 +1,631 @@
+#ifndef MINECRAFT_CHUNK_DATA_H
+#define MINECRAFT_CHUNK_DATA_H
+#include "core.h"
+#include "world/World.h"
+#include "world/BlockMap.h"
+#include "core/MemoryTracker.h"
+
+namespace Minecraft
+{
+	// Block storage for one chunk. Block ids are split into 16x16x16 sections, and each section stores
+	// a small palette of the ids it uses plus a bit-packed index into that palette for every block.
+	// Most sections only use a handful of ids, so this is a fraction of the size of a Block per block.
+	// Light is kept per section too. A section that's lit the same all the way through, like open sky
+	// or solid rock, only stores that one value. The rest get their own block light, sky light and
+	// light color arrays the first time a block in them is lit differently.
+	//
+	// Only one thread may write to a chunk at a time. Readers on other threads are fine though, a
+	// section that outgrows its palette is copied and swapped in, and the old copy isn't freed until
+	// the whole chunk is cleared. Light arrays are never swapped, they stay put until the clear.
+	class ChunkData
+	{
+	public:
+		static const int SectionHeight = 16;
+		static const int NumSections = World::ChunkHeight / SectionHeight;
+		static const int BlocksPerSection = World::ChunkWidth * World::ChunkDepth * SectionHeight;
+		static const int NumBlocks = BlocksPerSection * NumSections;
+
+		ChunkData()
+		{
+			for (std::atomic<Section*>& section : sections)
+			{
+				section.store(nullptr, std::memory_order_relaxed);
+			}
+			for (int sectionIndex = 0; sectionIndex < NumSections; sectionIndex++)
+			{
+				lightSections[sectionIndex].store(nullptr, std::memory_order_relaxed);
+				uniformLight[sectionIndex].store(0, std::memory_order_relaxed);
+			}
+			modified.store(false, std::memory_order_relaxed);
+		}
+
+		~ChunkData()
+		{
+			clear();
+		}
+
+		ChunkData(const ChunkData&) = delete;
+		ChunkData& operator=(const ChunkData&) = delete;
+
+		// Index is the same as the chunk's 1D block index. Y is the slowest axis, so each section is a
+		// contiguous range of BlocksPerSection indices
+		inline uint16 getId(int index) const
+		{
+			const Section* section = sections[index / BlocksPerSection].load(std::memory_order_acquire);
+			if (!section)
+			{
+				return 0;
+			}
+
+			if (section->bitsPerIndex == 0)
+			{
+				return section->palette[0];
+			}
+
+			uint32 bitIndex = (uint32)(index % BlocksPerSection) * section->bitsPerIndex;
+			uint32 paletteIndex = (uint32)(section->words[bitIndex / 64] >> (bitIndex % 64)) & ((1u << section->bitsPerIndex) - 1);
+			return section->bitsPerIndex == DirectBits ? (uint16)paletteIndex : section->palette[paletteIndex];
+		}
+
+		void setId(int index, uint16 id)
+		{
+			std::atomic<Section*>& sectionPtr = sections[index / BlocksPerSection];
+			Section* section = sectionPtr.load(std::memory_order_relaxed);
+			if (!section)
+			{
+				if (id == 0)
+				{
+					// Missing sections are already all zeros
+					return;
+				}
+
+				section = allocateSection(0);
+				section->palette[0] = 0;
+				section->paletteSize = 1;
+				sectionPtr.store(section, std::memory_order_release);
+			}
+
+			uint32 paletteIndex = findInPalette(section, id);
+			if (paletteIndex == UINT32_MAX)
+			{
+				if (section->paletteSize >= getPaletteCapacity(section->bitsPerIndex))
+				{
+					section = growSection(sectionPtr, section);
+				}
+
+				if (section->bitsPerIndex == DirectBits)
+				{
+					paletteIndex = id;
+				}
+				else
+				{
+					// The entry has to be written before any index can point at it
+					paletteIndex = section->paletteSize;
+					section->palette[paletteIndex] = id;
+					section->paletteSize++;
+				}
+			}
+
+			if (section->bitsPerIndex == 0)
+			{
+				return;
+			}
+
+			modified.store(true, std::memory_order_relaxed);
+			uint32 bitIndex = (uint32)(index % BlocksPerSection) * section->bitsPerIndex;
+			uint64 mask = ((uint64)1 << section->bitsPerIndex) - 1;
+			uint64& word = section->words[bitIndex / 64];
+			word = (word & ~(mask << (bitIndex % 64))) | ((uint64)paletteIndex << (bitIndex % 64));
+		}
+
+		// Puts the block back together the way it's laid out in a Block
+		inline Block getBlock(int index) const
+		{
+			int sectionIndex = index / BlocksPerSection;
+			const LightSection* light = lightSections[sectionIndex].load(std::memory_order_acquire);
+			if (!light)
+			{
+				uint32 uniform = uniformLight[sectionIndex].load(std::memory_order_relaxed);
+				uint16 lightLevel = (uint16)(getPackedBlockLight(uniform) | (getPackedSkyLight(uniform) << 5));
+				return { getId(index), lightLevel, getPackedLightColor(uniform), 0 };
+			}
+
+			int lightIndex = index % BlocksPerSection;
+			uint16 lightLevel = (uint16)(light->blockLight[lightIndex] | (light->skyLight[lightIndex] << 5));
+			return { getId(index), lightLevel, light->lightColor[lightIndex], 0 };
+		}
+
+		inline int calculatedLightLevel(int index) const
+		{
+			const LightSection* light = lightSections[index / BlocksPerSection].load(std::memory_order_acquire);
+			return light
+				? light->blockLight[index % BlocksPerSection]
+				: getPackedBlockLight(uniformLight[index / BlocksPerSection].load(std::memory_order_relaxed));
+		}
+
+		inline int calculatedSkyLightLevel(int index) const
+		{
+			const LightSection* light = lightSections[index / BlocksPerSection].load(std::memory_order_acquire);
+			return light
+				? light->skyLight[index % BlocksPerSection]
+				: getPackedSkyLight(uniformLight[index / BlocksPerSection].load(std::memory_order_relaxed));
+		}
+
+		inline int16 getLightColor(int index) const
+		{
+			const LightSection* light = lightSections[index / BlocksPerSection].load(std::memory_order_acquire);
+			return light
+				? light->lightColor[index % BlocksPerSection]
+				: getPackedLightColor(uniformLight[index / BlocksPerSection].load(std::memory_order_relaxed));
+		}
+
+		// Writing the value a uniform section already has doesn't need any storage
+		inline void setLightLevel(int index, int level)
+		{
+			int sectionIndex = index / BlocksPerSection;
+			LightSection* light = lightSections[sectionIndex].load(std::memory_order_relaxed);
+			if (!light)
+			{
+				if (getPackedBlockLight(uniformLight[sectionIndex].load(std::memory_order_relaxed)) == (level & 0x1f))
+				{
+					return;
+				}
+				light = allocateLightSection(sectionIndex);
+			}
+			light->blockLight[index % BlocksPerSection] = (uint8)(level & 0x1f);
+		}
+
+		inline void setSkyLightLevel(int index, int level)
+		{
+			int sectionIndex = index / BlocksPerSection;
+			LightSection* light = lightSections[sectionIndex].load(std::memory_order_relaxed);
+			if (!light)
+			{
+				if (getPackedSkyLight(uniformLight[sectionIndex].load(std::memory_order_relaxed)) == (level & 0x1f))
+				{
+					return;
+				}
+				light = allocateLightSection(sectionIndex);
+			}
+			light->skyLight[index % BlocksPerSection] = (uint8)(level & 0x1f);
+		}
+
+		inline void setLightColor(int index, int16 color)
+		{
+			int sectionIndex = index / BlocksPerSection;
+			LightSection* light = lightSections[sectionIndex].load(std::memory_order_relaxed);
+			if (!light)
+			{
+				if (getPackedLightColor(uniformLight[sectionIndex].load(std::memory_order_relaxed)) == color)
+				{
+					return;
+				}
+				light = allocateLightSection(sectionIndex);
+			}
+			light->lightColor[index % BlocksPerSection] = color;
+		}
+
+		// A uniform section is all one block id, either because it was never written to or because it was
+		// filled or compacted that way. Passes can treat the whole section as a single block
+		inline bool isSectionUniform(int sectionIndex, uint16& outId) const
+		{
+			const Section* section = sections[sectionIndex].load(std::memory_order_acquire);
+			if (!section)
+			{
+				outId = 0;
+				return true;
+			}
+
+			outId = section->palette[0];
+			return section->bitsPerIndex == 0;
+		}
+
+		// Sets every block in the section to the same id and light color
+		void fillSection(int sectionIndex, uint16 id, int16 color)
+		{
+			setUniformSection(sectionIndex, id);
+			LightSection* light = lightSections[sectionIndex].load(std::memory_order_relaxed);
+			if (!light)
+			{
+				uint32 uniform = uniformLight[sectionIndex].load(std::memory_order_relaxed);
+				uniformLight[sectionIndex].store(packLight(getPackedBlockLight(uniform), getPackedSkyLight(uniform), color), std::memory_order_relaxed);
+				return;
+			}
+
+			for (int i = 0; i < BlocksPerSection; i++)
+			{
+				light->lightColor[i] = color;
+			}
+		}
+
+		// Sections without light arrays only have the one value to change
+		void fillSectionSkyLight(int sectionIndex, int level, int16 color)
+		{
+			LightSection* light = lightSections[sectionIndex].load(std::memory_order_relaxed);
+			if (!light)
+			{
+				uint32 uniform = uniformLight[sectionIndex].load(std::memory_order_relaxed);
+				uniformLight[sectionIndex].store(packLight(getPackedBlockLight(uniform), level, color), std::memory_order_relaxed);
+				return;
+			}
+
+			for (int i = 0; i < BlocksPerSection; i++)
+			{
+				light->skyLight[i] = (uint8)(level & 0x1f);
+				light->lightColor[i] = color;
+			}
+		}
+
+		// Generation writes blocks one at a time, so sections that end up all one id still have a palette
+		// and packed indices. This turns them back into uniform sections
+		void compact()
+		{
+			for (int sectionIndex = 0; sectionIndex < NumSections; sectionIndex++)
+			{
+				const Section* section = sections[sectionIndex].load(std::memory_order_relaxed);
+				if (!section || section->bitsPerIndex == 0)
+				{
+					continue;
+				}
+
+				// Every index is the same if every word repeats the first index
+				uint64 firstIndex = section->words[0] & (((uint64)1 << section->bitsPerIndex) - 1);
+				uint64 pattern = 0;
+				for (uint32 bit = 0; bit < 64; bit += section->bitsPerIndex)
+				{
+					pattern |= firstIndex << bit;
+				}
+
+				bool uniform = true;
+				uint32 numWords = (BlocksPerSection * section->bitsPerIndex) / 64;
+				for (uint32 i = 0; i < numWords; i++)
+				{
+					if (section->words[i] != pattern)
+					{
+						uniform = false;
+						break;
+					}
+				}
+
+				if (uniform)
+				{
+					setUniformSection(sectionIndex, section->bitsPerIndex == DirectBits ? (uint16)firstIndex : section->palette[firstIndex]);
+				}
+			}
+		}
+
+		// Set whenever a block id changes, so chunks that haven't changed since they were last saved or
+		// loaded don't have to be written out again. Light is recalculated on load, so it doesn't count
+		inline bool isModified() const
+		{
+			return modified.load(std::memory_order_relaxed);
+		}
+
+		inline void clearModified()
+		{
+			modified.store(false, std::memory_order_relaxed);
+		}
+
+		// Everything this chunk's blocks take up, including the sections that live outside of it
+		size_t getMemoryUsed() const
+		{
+			size_t bytes = sizeof(ChunkData);
+			for (const std::atomic<Section*>& sectionPtr : sections)
+			{
+				const Section* section = sectionPtr.load(std::memory_order_relaxed);
+				if (section)
+				{
+					bytes += getSectionSize(section->bitsPerIndex);
+				}
+			}
+			for (const Section* section : retiredSections)
+			{
+				bytes += getSectionSize(section->bitsPerIndex);
+			}
+			for (const std::atomic<LightSection*>& light : lightSections)
+			{
+				if (light.load(std::memory_order_relaxed))
+				{
+					bytes += sizeof(LightSection);
+				}
+			}
+			return bytes;
+		}
+
+		// Zeroes block and sky light but keeps the light colors
+		void clearLight()
+		{
+			for (int sectionIndex = 0; sectionIndex < NumSections; sectionIndex++)
+			{
+				LightSection* light = lightSections[sectionIndex].load(std::memory_order_relaxed);
+				if (light)
+				{
+					g_memory_zeroMem(light->blockLight, sizeof(light->blockLight));
+					g_memory_zeroMem(light->skyLight, sizeof(light->skyLight));
+				}
+				else
+				{
+					uint32 uniform = uniformLight[sectionIndex].load(std::memory_order_relaxed);
+					uniformLight[sectionIndex].store(packLight(0, 0, getPackedLightColor(uniform)), std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Sets every block back to id 0 with no light and frees all the sections
+		void clear()
+		{
+			for (std::atomic<Section*>& section : sections)
+			{
+				Section* oldSection = section.exchange(nullptr, std::memory_order_acq_rel);
+				if (oldSection)
+				{
+					MemoryTracker::free(MemoryTag::ChunkBlocks, oldSection);
+				}
+			}
+
+			for (Section* section : retiredSections)
+			{
+				MemoryTracker::free(MemoryTag::ChunkBlocks, section);
+			}
+			retiredSections.clear();
+
+			for (int sectionIndex = 0; sectionIndex < NumSections; sectionIndex++)
+			{
+				LightSection* light = lightSections[sectionIndex].exchange(nullptr, std::memory_order_acq_rel);
+				if (light)
+				{
+					MemoryTracker::free(MemoryTag::ChunkBlocks, light);
+				}
+				uniformLight[sectionIndex].store(0, std::memory_order_relaxed);
+			}
+			modified.store(false, std::memory_order_relaxed);
+		}
+
+		// Unpacked copies, for the disk and the network which both still use one Block per block
+		void copyFrom(const Block* blocks)
+		{
+			clear();
+			for (int sectionIndex = 0; sectionIndex < NumSections; sectionIndex++)
+			{
+				copySectionFrom(sectionIndex, blocks + sectionIndex * BlocksPerSection);
+			}
+		}
+
+		// Blocks points at the section's first block, not the chunk's
+		void copySectionFrom(int sectionIndex, const Block* blocks)
+		{
+			bool uniform = true;
+			for (int i = 1; i < BlocksPerSection; i++)
+			{
+				if (blocks[i].id != blocks[0].id)
+				{
+					uniform = false;
+					break;
+				}
+			}
+
+			int firstIndex = sectionIndex * BlocksPerSection;
+			if (uniform)
+			{
+				setUniformSection(sectionIndex, blocks[0].id);
+			}
+			else
+			{
+				setUniformSection(sectionIndex, 0);
+				for (int i = 0; i < BlocksPerSection; i++)
+				{
+					setId(firstIndex + i, blocks[i].id);
+				}
+			}
+
+			bool uniformLightValues = true;
+			for (int i = 1; i < BlocksPerSection; i++)
+			{
+				if (blocks[i].lightLevel != blocks[0].lightLevel || blocks[i].lightColor != blocks[0].lightColor)
+				{
+					uniformLightValues = false;
+					break;
+				}
+			}
+
+			LightSection* light = lightSections[sectionIndex].load(std::memory_order_relaxed);
+			if (!light && uniformLightValues)
+			{
+				uniformLight[sectionIndex].store(
+					packLight(blocks[0].lightLevel & 0x1f, (blocks[0].lightLevel & 0x3e0) >> 5, blocks[0].lightColor),
+					std::memory_order_relaxed);
+				return;
+			}
+
+			if (!light)
+			{
+				light = allocateLightSection(sectionIndex);
+			}
+			for (int i = 0; i < BlocksPerSection; i++)
+			{
+				light->blockLight[i] = (uint8)(blocks[i].lightLevel & 0x1f);
+				light->skyLight[i] = (uint8)((blocks[i].lightLevel & 0x3e0) >> 5);
+				light->lightColor[i] = blocks[i].lightColor;
+			}
+		}
+
+		void copyTo(Block* blocks) const
+		{
+			for (int i = 0; i < NumBlocks; i++)
+			{
+				blocks[i] = getBlock(i);
+			}
+		}
+
+	private:
+		// Past 8 bits a palette stops paying for itself, so the indices are the block ids themselves
+		static const uint32 DirectBits = 16;
+
+		struct Section
+		{
+			uint32 bitsPerIndex;
+			uint32 paletteSize;
+			uint16* palette;
+			uint64* words;
+		};
+
+		struct LightSection
+		{
+			uint8 blockLight[BlocksPerSection];
+			uint8 skyLight[BlocksPerSection];
+			int16 lightColor[BlocksPerSection];
+		};
+
+		// A section without light arrays keeps its block light, sky light and light color packed in one
+		// value, so it can be read from another thread while it changes
+		static inline uint32 packLight(int blockLevel, int skyLevel, int16 color)
+		{
+			return (uint32)(blockLevel & 0x1f) | ((uint32)(skyLevel & 0x1f) << 8) | ((uint32)(uint16)color << 16);
+		}
+
+		static inline int getPackedBlockLight(uint32 packed)
+		{
+			return (int)(packed & 0xff);
+		}
+
+		static inline int getPackedSkyLight(uint32 packed)
+		{
+			return (int)((packed >> 8) & 0xff);
+		}
+
+		static inline int16 getPackedLightColor(uint32 packed)
+		{
+			return (int16)(uint16)(packed >> 16);
+		}
+
+		static uint32 getPaletteCapacity(uint32 bitsPerIndex)
+		{
+			return bitsPerIndex == DirectBits ? UINT32_MAX : (1u << bitsPerIndex);
+		}
+
+		static uint32 findInPalette(const Section* section, uint16 id)
+		{
+			if (section->bitsPerIndex == DirectBits)
+			{
+				return id;
+			}
+
+			for (uint32 i = 0; i < section->paletteSize; i++)
+			{
+				if (section->palette[i] == id)
+				{
+					return i;
+				}
+			}
+			return UINT32_MAX;
+		}
+
+		static size_t getPaletteBytes(uint32 bitsPerIndex)
+		{
+			size_t paletteBytes = bitsPerIndex == DirectBits ? 0 : sizeof(uint16) * getPaletteCapacity(bitsPerIndex);
+			return (paletteBytes + sizeof(uint64) - 1) & ~(sizeof(uint64) - 1);
+		}
+
+		static size_t getSectionSize(uint32 bitsPerIndex)
+		{
+			return sizeof(Section) + getPaletteBytes(bitsPerIndex) + ((size_t)BlocksPerSection * bitsPerIndex) / 8;
+		}
+
+		static Section* allocateSection(uint32 bitsPerIndex)
+		{
+			// The header, palette and packed indices all live in one allocation
+			size_t paletteBytes = getPaletteBytes(bitsPerIndex);
+			size_t wordBytes = ((size_t)BlocksPerSection * bitsPerIndex) / 8;
+			uint8* memory = (uint8*)MemoryTracker::allocate(MemoryTag::ChunkBlocks, getSectionSize(bitsPerIndex));
+
+			Section* section = (Section*)memory;
+			section->bitsPerIndex = bitsPerIndex;
+			section->paletteSize = 0;
+			section->palette = (uint16*)(memory + sizeof(Section));
+			section->words = (uint64*)(memory + sizeof(Section) + paletteBytes);
+			g_memory_zeroMem(section->words, wordBytes);
+			return section;
+		}
+
+		void setUniformSection(int sectionIndex, uint16 id)
+		{
+			Section* newSection = nullptr;
+			if (id != 0)
+			{
+				newSection = allocateSection(0);
+				newSection->palette[0] = id;
+				newSection->paletteSize = 1;
+			}
+
+			// Another thread could still be reading the old copy
+			modified.store(true, std::memory_order_relaxed);
+			Section* oldSection = sections[sectionIndex].exchange(newSection, std::memory_order_acq_rel);
+			if (oldSection)
+			{
+				retiredSections.push_back(oldSection);
+			}
+		}
+
+		LightSection* allocateLightSection(int sectionIndex)
+		{
+			// Starts out with the light the section had as a whole
+			LightSection* light = (LightSection*)MemoryTracker::allocate(MemoryTag::ChunkBlocks, sizeof(LightSection));
+			uint32 uniform = uniformLight[sectionIndex].load(std::memory_order_relaxed);
+			uint8 blockLevel = (uint8)getPackedBlockLight(uniform);
+			uint8 skyLevel = (uint8)getPackedSkyLight(uniform);
+			int16 color = getPackedLightColor(uniform);
+			for (int i = 0; i < BlocksPerSection; i++)
+			{
+				light->blockLight[i] = blockLevel;
+				light->skyLight[i] = skyLevel;
+				light->lightColor[i] = color;
+			}
+
+			lightSections[sectionIndex].store(light, std::memory_order_release);
+			return light;
+		}
+
+		Section* growSection(std::atomic<Section*>& sectionPtr, Section* oldSection)
+		{
+			uint32 newBits = oldSection->bitsPerIndex == 0 ? 1 : oldSection->bitsPerIndex * 2;
+			if (newBits > 8)
+			{
+				newBits = DirectBits;
+			}
+
+			Section* newSection = allocateSection(newBits);
+			if (newBits != DirectBits)
+			{
+				g_memory_copyMem(newSection->palette, oldSection->palette, sizeof(uint16) * oldSection->paletteSize);
+				newSection->paletteSize = oldSection->paletteSize;
+			}
+
+			for (uint32 i = 0; i < (uint32)BlocksPerSection; i++)
+			{
+				uint32 paletteIndex = 0;
+				if (oldSection->bitsPerIndex != 0)
+				{
+					uint32 bitIndex = i * oldSection->bitsPerIndex;
+					paletteIndex = (uint32)(oldSection->words[bitIndex / 64] >> (bitIndex % 64)) & ((1u << oldSection->bitsPerIndex) - 1);
+				}
+
+				uint64 newIndex = newBits == DirectBits ? oldSection->palette[paletteIndex] : paletteIndex;
+				uint32 newBitIndex = i * newBits;
+				newSection->words[newBitIndex / 64] |= newIndex << (newBitIndex % 64);
+			}
+
+			// Another thread could still be reading the old copy
+			sectionPtr.store(newSection, std::memory_order_release);
+			retiredSections.push_back(oldSection);
+			return newSection;
+		}
+
+		std::array<std::atomic<Section*>, NumSections> sections;
+		std::vector<Section*> retiredSections;
+		std::array<std::atomic<LightSection*>, NumSections> lightSections;
+		std::array<std::atomic<uint32>, NumSections> uniformLight;
+		std::atomic<bool> modified;
+	};
+}
+
+#endif
\ No newline at end of file
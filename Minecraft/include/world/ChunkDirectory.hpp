@@ -0,0 +1,210 @@
+#ifndef MINECRAFT_CHUNK_DIRECTORY_H
+#define MINECRAFT_CHUNK_DIRECTORY_H
+#include "core.h"
+#include "world/Chunk.hpp"
+
+namespace Minecraft
+{
+	// Refers to one particular chunk. If that chunk gets unloaded and a new one is loaded at the
+	// same coordinates, the handle won't resolve to the new chunk
+	struct ChunkHandle
+	{
+		glm::ivec2 chunkCoords;
+		uint32 generation;
+	};
+
+	// Keeps a chunk pinned for as long as it's alive, so it won't be erased out from under whoever
+	// holds it. Copies pin the chunk again, moves hand the pin over
+	class PinnedChunk
+	{
+	public:
+		PinnedChunk(Chunk* chunk = nullptr)
+			: chunk(chunk)
+		{
+			pin();
+		}
+
+		PinnedChunk(const PinnedChunk& other)
+			: chunk(other.chunk)
+		{
+			pin();
+		}
+
+		PinnedChunk(PinnedChunk&& other) noexcept
+			: chunk(other.chunk)
+		{
+			other.chunk = nullptr;
+		}
+
+		~PinnedChunk()
+		{
+			unpin();
+		}
+
+		PinnedChunk& operator=(const PinnedChunk& other)
+		{
+			if (chunk != other.chunk)
+			{
+				unpin();
+				chunk = other.chunk;
+				pin();
+			}
+			return *this;
+		}
+
+		PinnedChunk& operator=(PinnedChunk&& other) noexcept
+		{
+			if (this != &other)
+			{
+				unpin();
+				chunk = other.chunk;
+				other.chunk = nullptr;
+			}
+			return *this;
+		}
+
+		Chunk* operator->() const
+		{
+			return chunk;
+		}
+
+		operator Chunk*() const
+		{
+			return chunk;
+		}
+
+	private:
+		void pin()
+		{
+			if (chunk)
+			{
+				chunk->pinCount.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		void unpin()
+		{
+			if (chunk)
+			{
+				// Release so everything done with the chunk happens before the main thread sees it unpinned
+				chunk->pinCount.fetch_sub(1, std::memory_order_acq_rel);
+			}
+		}
+
+		Chunk* chunk;
+	};
+
+	// Thread-safe map of all loaded chunks. The chunks are split across shards that each have their own
+	// lock, so lookups from the workers don't contend with each other or with the main thread loading
+	// chunks somewhere else. Chunks never move once inserted, so pointers stay valid until they're erased
+	class ChunkDirectory
+	{
+	public:
+		static const int NumShards = 16;
+
+		ChunkDirectory()
+		{
+			nextGeneration = 1;
+		}
+
+		Chunk* find(const glm::ivec2& chunkCoords)
+		{
+			Shard& shard = getShard(chunkCoords);
+			std::shared_lock<std::shared_mutex> lock(shard.mtx);
+			auto iter = shard.chunks.find(chunkCoords);
+			return iter != shard.chunks.end() ? &iter->second : nullptr;
+		}
+
+		// Returns nullptr if the chunk the handle was made for is gone
+		Chunk* resolve(const ChunkHandle& handle)
+		{
+			Shard& shard = getShard(handle.chunkCoords);
+			std::shared_lock<std::shared_mutex> lock(shard.mtx);
+			auto iter = shard.chunks.find(handle.chunkCoords);
+			if (iter == shard.chunks.end() || iter->second.generation != handle.generation)
+			{
+				return nullptr;
+			}
+			return &iter->second;
+		}
+
+		// Returns nullptr if there's already a chunk at these coordinates
+		Chunk* insert(const glm::ivec2& chunkCoords)
+		{
+			Shard& shard = getShard(chunkCoords);
+			std::unique_lock<std::shared_mutex> lock(shard.mtx);
+			if (shard.chunks.find(chunkCoords) != shard.chunks.end())
+			{
+				return nullptr;
+			}
+
+			Chunk& chunk = shard.chunks[chunkCoords];
+			chunk.chunkCoords = chunkCoords;
+			chunk.generation = nextGeneration++;
+			chunk.pinCount = 0;
+			numChunks++;
+			return &chunk;
+		}
+
+		void erase(const glm::ivec2& chunkCoords)
+		{
+			Shard& shard = getShard(chunkCoords);
+			std::unique_lock<std::shared_mutex> lock(shard.mtx);
+			numChunks -= (uint32)shard.chunks.erase(chunkCoords);
+		}
+
+		void clear()
+		{
+			for (Shard& shard : shards)
+			{
+				std::unique_lock<std::shared_mutex> lock(shard.mtx);
+				shard.chunks.clear();
+			}
+			numChunks = 0;
+		}
+
+		// Calls fn with every chunk while holding its shard's lock, so fn must not look up, insert or
+		// erase chunks itself. Collect what you need and do that afterwards instead
+		template<typename Fn>
+		void forEach(Fn&& fn)
+		{
+			for (Shard& shard : shards)
+			{
+				std::shared_lock<std::shared_mutex> lock(shard.mtx);
+				for (auto& pair : shard.chunks)
+				{
+					fn(pair.second);
+				}
+			}
+		}
+
+		uint32 size() const
+		{
+			return numChunks;
+		}
+
+		static ChunkHandle getHandle(const Chunk* chunk)
+		{
+			return { chunk->chunkCoords, chunk->generation };
+		}
+
+	private:
+		struct Shard
+		{
+			std::shared_mutex mtx;
+			robin_hood::unordered_node_map<glm::ivec2, Chunk> chunks;
+		};
+
+		Shard& getShard(const glm::ivec2& chunkCoords)
+		{
+			uint32 hash = ((uint32)chunkCoords.x * 73856093u) ^ ((uint32)chunkCoords.y * 19349663u);
+			return shards[hash % NumShards];
+		}
+
+		std::array<Shard, NumShards> shards;
+		std::atomic<uint32> nextGeneration;
+		std::atomic<uint32> numChunks = 0;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -10,6 +10,7 @@ namespace Minecraft
 	struct Block;
 	class Frustum;
 	struct Chunk;
+	class ChunkDirectory;
 	enum class ChunkState : uint8;
 
 	enum class SubChunkState : uint8
@@ -17,8 +18,6 @@ namespace Minecraft
 		Unloaded,
 		LoadBlockData,
 		LoadingBlockData,
-		RetesselateVertices,
-		DoneRetesselating,
 		TesselateVertices,
 		TesselatingVertices,
 		UploadVerticesToGpu,
@@ -33,11 +32,14 @@ namespace Minecraft
 
 	struct SubChunk
 	{
-		Vertex* data;
+		// Where the mesh starts in the global vertex buffer, and the allocation that owns it
 		uint32 first;
+		uint32 vertexAllocation;
 		uint32 drawCommandIndex;
 		uint8 subChunkLevel;
 		glm::ivec2 chunkCoordinates;
+		// Which mesh of the chunk this belongs to, sub-chunks from older meshes get freed once a newer one finishes
+		uint32 meshVersion;
 		std::atomic<bool> isBlendable;
 		std::atomic<uint32> numVertsUsed;
 		std::atomic<SubChunkState> state;
@@ -45,10 +47,10 @@ namespace Minecraft
 
 	namespace ChunkManager
 	{
-		void init();
+		void init(bool headless = false);
 		void free();
 		void serialize();
-		robin_hood::unordered_node_map<glm::ivec2, Chunk>& getAllChunks();
+		ChunkDirectory& getAllChunks();
 
 		Block getBlock(const glm::vec3& worldPosition);
 		void setBlock(const glm::vec3& worldPosition, Block newBlock);
@@ -61,14 +63,19 @@ namespace Minecraft
 		void beginWork();
 
 		void queueClientLoadChunk(void* chunkData, const glm::ivec2& chunkCoordinates, ChunkState state);
-		void queueGenerateDecorations(const glm::ivec2& lastPlayerLoadChunkPos);
-		void queueCalculateLighting(const glm::ivec2& lastPlayerPosInChunkCoords);
 		void queueCreateChunk(const glm::ivec2& chunkCoordinates);
 		void queueSaveChunk(const glm::ivec2& chunkCoordinates);
 		void queueRecalculateLighting(const glm::ivec2& chunkCoordinates, const glm::vec3& blockPositionThatUpdated, bool removedLightSource);
 		void queueRetesselateChunk(const glm::ivec2& chunkCoordinates, Chunk* chunk = nullptr, bool doImmediately = false);
 		void render(const glm::vec3& playerPosition, const glm::ivec2& playerPositionInChunkCoords, Shader& opaqueShader, Shader& transparentShader, const Frustum& cameraFrustum);
 		void checkChunkRadius(const glm::vec3& playerPosition);
+		// Saves and reloads every chunk when the world is already loaded, since all the pools are sized for the radius
+		void setChunkRadius(int radius);
+		int getChunkRadius();
+		// Re-meshes every loaded chunk if this changes the setting
+		void setGreedyMeshing(bool enabled);
+		// Generates, decorates, lights and saves every chunk within radius chunks of centerPosition. Headless only
+		void pregenerate(const glm::vec3& centerPosition, int radius);
 
 		extern bool doStepLogic;
 	}
@@ -0,0 +1,133 @@
+#ifndef MINECRAFT_CHUNK_SNAPSHOT_H
+#define MINECRAFT_CHUNK_SNAPSHOT_H
+#include "core.h"
+#include "world/World.h"
+#include "world/BlockMap.h"
+#include "world/Chunk.hpp"
+#include "world/ChunkData.hpp"
+
+namespace Minecraft
+{
+	// Unpacked copy of one chunk plus a one block border taken from its 8 neighbors. Anything
+	// above or below the world, or in a neighbor that isn't loaded, is a null block. Meshing and
+	// lighting look at the blocks around every block they visit, so they copy the chunk in here once
+	// and then every lookup is a plain array read that never has to follow a neighbor pointer.
+	//
+	// These are big, so each worker keeps one around and reuses it for every command.
+	class ChunkSnapshot
+	{
+	public:
+		static const int PaddedDepth = World::ChunkDepth + 2;
+		static const int PaddedWidth = World::ChunkWidth + 2;
+		static const int PaddedHeight = World::ChunkHeight + 2;
+		static const int NumBlocks = PaddedDepth * PaddedWidth * PaddedHeight;
+
+		// Coordinates are local to the chunk, so -1 and ChunkDepth/ChunkHeight/ChunkWidth are the border
+		inline const Block& get(int x, int y, int z) const
+		{
+			return blocks[toPaddedIndex(x, y, z)];
+		}
+
+		// Same as ChunkData::isSectionUniform for the chunk this was copied from
+		inline bool isSectionUniform(int sectionIndex, uint16& outId) const
+		{
+			outId = sectionIds[sectionIndex];
+			return sectionUniform[sectionIndex];
+		}
+
+		// The caller has to make sure nothing is writing to the chunk or its neighbors while this runs.
+		// Only rows minY - 1 through maxY + 1 get copied, everything else is left as it was
+		void copyFrom(const Chunk* chunk, int minY = 0, int maxY = World::ChunkHeight - 1)
+		{
+			const int firstY = glm::max(minY - 1, 0);
+			const int lastY = glm::min(maxY + 1, World::ChunkHeight - 1);
+
+			// Above and below the world
+			for (int x = -1; x <= World::ChunkDepth; x++)
+			{
+				for (int z = -1; z <= World::ChunkWidth; z++)
+				{
+					blocks[toPaddedIndex(x, -1, z)] = BlockMap::NULL_BLOCK;
+					blocks[toPaddedIndex(x, World::ChunkHeight, z)] = BlockMap::NULL_BLOCK;
+				}
+			}
+
+			const ChunkData* data = chunk->data;
+			for (int sectionIndex = 0; sectionIndex < ChunkData::NumSections; sectionIndex++)
+			{
+				uint16 uniformId;
+				bool uniform = data->isSectionUniform(sectionIndex, uniformId);
+				sectionUniform[sectionIndex] = uniform;
+				sectionIds[sectionIndex] = uniformId;
+
+				int sectionFirstY = glm::max(sectionIndex * ChunkData::SectionHeight, firstY);
+				int sectionLastY = glm::min((sectionIndex + 1) * ChunkData::SectionHeight - 1, lastY);
+				for (int y = sectionFirstY; y <= sectionLastY; y++)
+				{
+					for (int x = 0; x < World::ChunkDepth; x++)
+					{
+						for (int z = 0; z < World::ChunkWidth; z++)
+						{
+							int index = (x * World::ChunkDepth) + (y * World::ChunkHeight) + z;
+							Block& block = blocks[toPaddedIndex(x, y, z)];
+							// Uniform sections don't need to go through the palette
+							block.id = uniform ? uniformId : data->getId(index);
+							block.lightLevel = (uint16)(data->calculatedLightLevel(index) | (data->calculatedSkyLightLevel(index) << 5));
+							block.lightColor = data->getLightColor(index);
+							block.padding = 0;
+						}
+					}
+				}
+			}
+
+			// The edges shared with the 4 direct neighbors
+			for (int i = 0; i < World::ChunkWidth; i++)
+			{
+				copyColumn(chunk->topNeighbor, 0, i, World::ChunkDepth, i, firstY, lastY);
+				copyColumn(chunk->bottomNeighbor, World::ChunkDepth - 1, i, -1, i, firstY, lastY);
+			}
+			for (int i = 0; i < World::ChunkDepth; i++)
+			{
+				copyColumn(chunk->rightNeighbor, i, 0, i, World::ChunkWidth, firstY, lastY);
+				copyColumn(chunk->leftNeighbor, i, World::ChunkWidth - 1, i, -1, firstY, lastY);
+			}
+
+			// The corners, reached through the top and bottom neighbors the same way getBlockInternal does
+			const Chunk* topNeighbor = chunk->topNeighbor;
+			const Chunk* bottomNeighbor = chunk->bottomNeighbor;
+			copyColumn(topNeighbor ? topNeighbor->rightNeighbor : nullptr, 0, 0, World::ChunkDepth, World::ChunkWidth, firstY, lastY);
+			copyColumn(topNeighbor ? topNeighbor->leftNeighbor : nullptr, 0, World::ChunkWidth - 1, World::ChunkDepth, -1, firstY, lastY);
+			copyColumn(bottomNeighbor ? bottomNeighbor->rightNeighbor : nullptr, World::ChunkDepth - 1, 0, -1, World::ChunkWidth, firstY, lastY);
+			copyColumn(bottomNeighbor ? bottomNeighbor->leftNeighbor : nullptr, World::ChunkDepth - 1, World::ChunkWidth - 1, -1, -1, firstY, lastY);
+		}
+
+	private:
+		static inline int toPaddedIndex(int x, int y, int z)
+		{
+			// Y is the slowest axis like it is in the chunk, so a horizontal slice is contiguous
+			return (((y + 1) * PaddedDepth) + (x + 1)) * PaddedWidth + (z + 1);
+		}
+
+		void copyColumn(const Chunk* source, int sourceX, int sourceZ, int x, int z, int firstY, int lastY)
+		{
+			for (int y = firstY; y <= lastY; y++)
+			{
+				Block& block = blocks[toPaddedIndex(x, y, z)];
+				if (!source)
+				{
+					block = BlockMap::NULL_BLOCK;
+					continue;
+				}
+
+				int index = (sourceX * World::ChunkDepth) + (y * World::ChunkHeight) + sourceZ;
+				block = source->data->getBlock(index);
+			}
+		}
+
+		Block blocks[NumBlocks];
+		uint16 sectionIds[ChunkData::NumSections];
+		bool sectionUniform[ChunkData::NumSections];
+	};
+}
+
+#endif
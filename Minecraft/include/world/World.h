@@ -12,6 +12,8 @@ namespace Minecraft
 	namespace World
 	{
 		void init(Ecs::Registry& registry, const char* hostname = "", int port = 0);
+		// Generates and saves the chunks around spawn without a window, savePath must be set first
+		void pregenerate(int radius);
 		void free();
 		void update(float dt, Frustum& cameraFrustum, const Texture& worldTexture);
 		void serialize();
@@ -24,14 +26,17 @@ namespace Minecraft
 		void givePlayerBlock(int blockId, int blockCount);
 		bool isPlayerUnderwater();
 
-		const uint16 ChunkRadius = 12;
-		const uint16 ChunkCapacity = (ChunkRadius * 2) * (ChunkRadius * 2);
+		// The render distance is Settings::Chunks::chunkRadius, which gets clamped to this range
+		const uint16 MinChunkRadius = 2;
+		const uint16 MaxChunkRadius = 32;
 
 		const uint16 ChunkWidth = 16;
 		const uint16 ChunkDepth = 16;
 		const uint16 ChunkHeight = 256;
 
-		const uint16 MaxVertsPerSubChunk = 1'500;
+		// The vertex buffer has room for this many vertices per sub-chunk on average, but any single
+		// sub-chunk gets exactly as many as its mesh needs
+		const uint16 AverageVertsPerSubChunk = 1'500;
 
 		extern std::string savePath;
 		extern std::string chunkSavePath;
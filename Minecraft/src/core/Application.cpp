@@ -4,6 +4,7 @@
 #include "core/Ecs.h"
 #include "core/Scene.h"
 #include "core/AppData.h"
+#include "core/File.h"
 #include "renderer/Renderer.h"
 #include "renderer/Font.h"
 #include "renderer/Framebuffer.h"
@@ -14,6 +15,9 @@
 #include "input/KeyBindings.h"
 #include "utils/Constants.h"
 #include "utils/Settings.h"
+#include "utils/TexturePacker.h"
+#include "world/BlockMap.h"
+#include "world/World.h"
 #include "gui/Gui.h"
 #include "gui/GuiElements.h"
 
@@ -242,6 +246,19 @@ namespace Minecraft
 			freeRegistry();
 		}
 
+		void pregenerateWorld(const char* worldName, int radius)
+		{
+			// Only load what terrain generation and lighting need. Nothing here touches the GPU
+			AppData::init();
+			File::createDirIfNotExists("assets/generated");
+			TexturePacker::packTextures("assets/images/block", "assets/generated/textureFormat.yaml", "assets/generated/packedTextures.png", "Blocks");
+			TexturePacker::packTextures("assets/images/item", "assets/generated/itemTextureFormat.yaml", "assets/generated/packedItemTextures.png", "Items");
+			BlockMap::loadBlocks("assets/generated/textureFormat.yaml", "assets/generated/itemTextureFormat.yaml", "assets/custom/blockFormats.yaml");
+
+			World::savePath = worldName;
+			World::pregenerate(radius);
+		}
+
 		Window& getWindow()
 		{
 			static Window* window = Window::create(Settings::Window::title);
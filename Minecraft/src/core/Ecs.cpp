@@ -16,19 +16,19 @@ namespace Minecraft
 		{
 			if (pools)
 			{
-				g_memory_free(pools);
+				MemoryTracker::free(MemoryTag::Ecs, pools);
 				pools = nullptr;
 			}
 
 			if (entities)
 			{
-				g_memory_free(entities);
+				MemoryTracker::free(MemoryTag::Ecs, entities);
 				entities = nullptr;
 			}
 
 			if (data)
 			{
-				g_memory_free(data);
+				MemoryTracker::free(MemoryTag::Ecs, data);
 				data = nullptr;
 			}
 
@@ -0,0 +1,138 @@
+#include "core.h"
+#include "core/MemoryTracker.h"
+
+namespace Minecraft
+{
+	namespace MemoryTracker
+	{
+		static const int NumTags = (int)MemoryTag::Length;
+		// Every heap allocation starts with its size. Padded out so the memory we hand back keeps the
+		// alignment the allocator gave us
+		static const size_t HeaderSize = 16;
+
+		static std::array<std::atomic<size_t>, NumTags> current = {};
+		static std::array<std::atomic<size_t>, NumTags> peak = {};
+		static std::array<std::atomic<size_t>, NumTags> budgets = {};
+
+		static const char* tagNames[NumTags] = {
+			"Chunk Blocks",
+			"Sub-Chunk Vertices",
+			"Network",
+			"ECS",
+			"Textures",
+			"Fonts"
+		};
+
+		void* allocate(MemoryTag tag, size_t numBytes)
+		{
+			uint8* memory = (uint8*)g_memory_allocate(numBytes + HeaderSize);
+			if (!memory)
+			{
+				return nullptr;
+			}
+
+			*(size_t*)memory = numBytes;
+			add(tag, numBytes);
+			return memory + HeaderSize;
+		}
+
+		void* reallocate(MemoryTag tag, void* memory, size_t numBytes)
+		{
+			if (!memory)
+			{
+				return allocate(tag, numBytes);
+			}
+
+			uint8* header = (uint8*)memory - HeaderSize;
+			size_t oldNumBytes = *(size_t*)header;
+			uint8* newMemory = (uint8*)g_memory_realloc(header, numBytes + HeaderSize);
+			if (!newMemory)
+			{
+				return nullptr;
+			}
+
+			*(size_t*)newMemory = numBytes;
+			remove(tag, oldNumBytes);
+			add(tag, numBytes);
+			return newMemory + HeaderSize;
+		}
+
+		void free(MemoryTag tag, void* memory)
+		{
+			if (!memory)
+			{
+				return;
+			}
+
+			uint8* header = (uint8*)memory - HeaderSize;
+			remove(tag, *(size_t*)header);
+			g_memory_free(header);
+		}
+
+		void add(MemoryTag tag, size_t numBytes)
+		{
+			int index = (int)tag;
+			size_t newTotal = current[index].fetch_add(numBytes, std::memory_order_relaxed) + numBytes;
+			size_t oldPeak = peak[index].load(std::memory_order_relaxed);
+			while (newTotal > oldPeak && !peak[index].compare_exchange_weak(oldPeak, newTotal, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		void remove(MemoryTag tag, size_t numBytes)
+		{
+			size_t oldTotal = current[(int)tag].fetch_sub(numBytes, std::memory_order_relaxed);
+			g_logger_assert(oldTotal >= numBytes, "Removed more memory than was ever added for '%s'.", getName(tag));
+		}
+
+		size_t getCurrent(MemoryTag tag)
+		{
+			return current[(int)tag].load(std::memory_order_relaxed);
+		}
+
+		size_t getPeak(MemoryTag tag)
+		{
+			return peak[(int)tag].load(std::memory_order_relaxed);
+		}
+
+		void setBudget(MemoryTag tag, size_t numBytes)
+		{
+			budgets[(int)tag].store(numBytes, std::memory_order_relaxed);
+		}
+
+		size_t getBudget(MemoryTag tag)
+		{
+			return budgets[(int)tag].load(std::memory_order_relaxed);
+		}
+
+		bool isOverBudget(MemoryTag tag, size_t numBytes)
+		{
+			size_t budget = getBudget(tag);
+			return budget != 0 && getCurrent(tag) + numBytes > budget;
+		}
+
+		const char* getName(MemoryTag tag)
+		{
+			return (int)tag < NumTags ? tagNames[(int)tag] : "Unknown";
+		}
+
+		void logUsage()
+		{
+			for (int i = 0; i < NumTags; i++)
+			{
+				MemoryTag tag = (MemoryTag)i;
+				size_t budget = getBudget(tag);
+				if (budget != 0)
+				{
+					g_logger_info("%s: %2.3f MB (peak %2.3f MB, budget %2.3f MB)", getName(tag),
+						getCurrent(tag) / (1024.0f * 1024.0f), getPeak(tag) / (1024.0f * 1024.0f), budget / (1024.0f * 1024.0f));
+				}
+				else
+				{
+					g_logger_info("%s: %2.3f MB (peak %2.3f MB)", getName(tag),
+						getCurrent(tag) / (1024.0f * 1024.0f), getPeak(tag) / (1024.0f * 1024.0f));
+				}
+			}
+		}
+	}
+}
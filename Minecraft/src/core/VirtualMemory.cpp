@@ -0,0 +1,119 @@
+#include "core.h"
+#include "core/VirtualMemory.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+
+namespace Minecraft
+{
+	namespace VirtualMemory
+	{
+		size_t getPageSize()
+		{
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return (size_t)info.dwPageSize;
+		}
+
+		void* allocate(size_t numBytes)
+		{
+			// Large pages need a special privilege on Windows, so these are always regular pages
+			return VirtualAlloc(NULL, numBytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		}
+
+		void free(void* memory, size_t numBytes)
+		{
+			if (memory)
+			{
+				VirtualFree(memory, 0, MEM_RELEASE);
+			}
+		}
+
+		void release(void* memory, size_t numBytes)
+		{
+			size_t pageSize = getPageSize();
+			uintptr_t start = ((uintptr_t)memory + pageSize - 1) & ~(uintptr_t)(pageSize - 1);
+			uintptr_t end = ((uintptr_t)memory + numBytes) & ~(uintptr_t)(pageSize - 1);
+			if (end <= start)
+			{
+				return;
+			}
+
+			// Decommitting throws the pages away, committing again brings them back zeroed on first touch
+			VirtualFree((void*)start, end - start, MEM_DECOMMIT);
+			VirtualAlloc((void*)start, end - start, MEM_COMMIT, PAGE_READWRITE);
+		}
+	}
+}
+
+// end _WIN_32
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace Minecraft
+{
+	namespace VirtualMemory
+	{
+		static const size_t HugePageSize = 2 * 1024 * 1024;
+
+		size_t getPageSize()
+		{
+			return (size_t)sysconf(_SC_PAGESIZE);
+		}
+
+		void* allocate(size_t numBytes)
+		{
+			// Map a huge page more than needed and trim both ends, so the start lines up with a huge page
+			size_t pageSize = getPageSize();
+			numBytes = (numBytes + pageSize - 1) & ~(pageSize - 1);
+			uint8* mapping = (uint8*)mmap(NULL, numBytes + HugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (mapping == MAP_FAILED)
+			{
+				return nullptr;
+			}
+
+			uint8* memory = (uint8*)(((uintptr_t)mapping + HugePageSize - 1) & ~(uintptr_t)(HugePageSize - 1));
+			if (memory > mapping)
+			{
+				munmap(mapping, memory - mapping);
+			}
+			uint8* mappingEnd = mapping + numBytes + HugePageSize;
+			if (mappingEnd > memory + numBytes)
+			{
+				munmap(memory + numBytes, mappingEnd - (memory + numBytes));
+			}
+
+#ifdef MADV_HUGEPAGE
+			// Transparent huge pages cut down on TLB misses when lighting and meshing sweep over whole chunks
+			madvise(memory, numBytes, MADV_HUGEPAGE);
+#endif
+			return memory;
+		}
+
+		void free(void* memory, size_t numBytes)
+		{
+			if (memory)
+			{
+				size_t pageSize = getPageSize();
+				munmap(memory, (numBytes + pageSize - 1) & ~(pageSize - 1));
+			}
+		}
+
+		void release(void* memory, size_t numBytes)
+		{
+			size_t pageSize = getPageSize();
+			uintptr_t start = ((uintptr_t)memory + pageSize - 1) & ~(uintptr_t)(pageSize - 1);
+			uintptr_t end = ((uintptr_t)memory + numBytes) & ~(uintptr_t)(pageSize - 1);
+			if (end <= start)
+			{
+				return;
+			}
+
+			madvise((void*)start, end - start, MADV_DONTNEED);
+		}
+	}
+}
+
+// end POSIX
+#endif
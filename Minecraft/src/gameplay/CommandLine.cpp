@@ -30,6 +30,8 @@ namespace Minecraft
 		DoDaylightCycle,
 		SetTime,
 		StopNetwork,
+		RenderDistance,
+		GreedyMeshing,
 		Length
 	};
 
@@ -43,6 +45,8 @@ namespace Minecraft
 		static void executeDebugLight(CommandStringView* args, int argsLength);
 		static void executeDoDaylightCycle(CommandStringView* args, int argsLength);
 		static void executeSetTime(CommandStringView* args, int argsLength);
+		static void executeRenderDistance(CommandStringView* args, int argsLength);
+		static void executeGreedyMeshing(CommandStringView* args, int argsLength);
 
 		static inline bool isNumber(char c) { return c >= '0' && c <= '9'; }
 		static inline bool isIntegerDigit(char c) { return isNumber(c) || c == '+' || c == '-'; }
@@ -202,6 +206,12 @@ namespace Minecraft
 			case CommandLineType::StopNetwork:
 				Network::free();
 				break;
+			case CommandLineType::RenderDistance:
+				executeRenderDistance(args, argsLength);
+				break;
+			case CommandLineType::GreedyMeshing:
+				executeGreedyMeshing(args, argsLength);
+				break;
 			default:
 				g_logger_warning("Unknown command line type: %s", magic_enum::enum_name(type).data());
 				break;
@@ -305,6 +315,51 @@ namespace Minecraft
 			World::worldTime = time;
 		}
 
+		static void executeRenderDistance(CommandStringView* args, int argsLength)
+		{
+			if (argsLength != 1)
+			{
+				g_logger_warning("RenderDistance expects 1 argument: The number of chunks from %d-%d.", World::MinChunkRadius, World::MaxChunkRadius);
+				return;
+			}
+
+			if (!isInteger(args[0].string, args[0].length))
+			{
+				g_logger_warning("RenderDistance expects an integer between %d-%d.", World::MinChunkRadius, World::MaxChunkRadius);
+				return;
+			}
+			int radius = atoi(args[0].string);
+			if (radius < World::MinChunkRadius || radius > World::MaxChunkRadius)
+			{
+				g_logger_warning("Invalid render distance '%d' passed to RenderDistance. RenderDistance expects an integer between %d-%d.", radius, World::MinChunkRadius, World::MaxChunkRadius);
+				return;
+			}
+
+			ChunkManager::setChunkRadius(radius);
+			// TODO: Put this in the chat
+			g_logger_info("RenderDistance: %d", radius);
+		}
+
+		static void executeGreedyMeshing(CommandStringView* args, int argsLength)
+		{
+			if (argsLength != 1)
+			{
+				g_logger_warning("GreedyMeshing expects 1 argument: 'true' or 'false'.");
+				return;
+			}
+
+			bool val;
+			if (!parseBoolean(args[0].string, args[0].length, &val))
+			{
+				g_logger_warning("GreedyMeshing expects 'true' or 'false'.");
+				return;
+			}
+
+			ChunkManager::setGreedyMeshing(val);
+			// TODO: Put this in the chat
+			g_logger_info("GreedyMeshing: %d", val);
+		}
+
 		static bool parseBoolean(const char* str, int strLength, bool* result)
 		{
 			// The words True or False are at least 4 characters long
@@ -11,6 +11,8 @@
 #include "core/Application.h"
 #include "core/Window.h"
 #include "core/Scene.h"
+#include "utils/Settings.h"
+#include "world/World.h"
 
 namespace Minecraft
 {
@@ -92,6 +94,27 @@ namespace Minecraft
 					Scene::changeScene(SceneType::LocalLanGame);
 				}
 
+				Gui::advanceCursor(glm::vec2(0.0f, 0.15f));
+				Gui::centerNextElement();
+				// Steps through a few common render distances and wraps back around to the smallest
+				static std::array<char, 32> renderDistanceText;
+				snprintf(renderDistanceText.data(), renderDistanceText.size(), "Render Distance: %u", Settings::Chunks::chunkRadius);
+				button.text = renderDistanceText.data();
+				if (Gui::textureButton(button))
+				{
+					static const uint32 renderDistances[] = { 6, 8, 12, 16, 24, World::MaxChunkRadius };
+					uint32 nextRenderDistance = renderDistances[0];
+					for (uint32 renderDistance : renderDistances)
+					{
+						if (renderDistance > Settings::Chunks::chunkRadius)
+						{
+							nextRenderDistance = renderDistance;
+							break;
+						}
+					}
+					Settings::Chunks::chunkRadius = nextRenderDistance;
+				}
+
 				Gui::advanceCursor(glm::vec2(0.0f, 0.15f));
 				Gui::centerNextElement();
 				button.text = "Quit";
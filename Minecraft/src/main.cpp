@@ -3,8 +3,9 @@
 #include <cppUtils/cppUtils.hpp>
 #include "core/Application.h"
 #include "world/TerrainGenerator.h"
+#include "utils/Settings.h"
 
-int main()
+int main(int argc, char** argv)
 {
 	//_CrtSetDbgFlag(_CRTDBG_CHECK_ALWAYS_DF);
 
@@ -13,6 +14,40 @@ int main()
 	g_logger_set_level(g_logger_level::Info);
 #endif
 
+	// Usage: --render-distance <radiusInChunks> can go anywhere, it's taken out before anything else is parsed
+	int numArgs = 0;
+	for (int i = 0; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--render-distance") == 0)
+		{
+			if (i + 1 >= argc || atoi(argv[i + 1]) <= 0)
+			{
+				g_logger_error("Usage: %s --render-distance <radiusInChunks>", argv[0]);
+				return 1;
+			}
+
+			Minecraft::Settings::Chunks::chunkRadius = (uint32)atoi(argv[i + 1]);
+			i++;
+			continue;
+		}
+		argv[numArgs++] = argv[i];
+	}
+	argc = numArgs;
+
+	// Usage: --pregen <worldName> <radiusInChunks>
+	if (argc > 1 && strcmp(argv[1], "--pregen") == 0)
+	{
+		if (argc < 4 || atoi(argv[3]) <= 0)
+		{
+			g_logger_error("Usage: %s --pregen <worldName> <radiusInChunks>", argv[0]);
+			return 1;
+		}
+
+		Minecraft::Application::pregenerateWorld(argv[2], atoi(argv[3]));
+		g_memory_dumpMemoryLeaks();
+		return 0;
+	}
+
 	//Minecraft::TerrainGenerator::outputNoiseToTextures();
 	//return 0;
 
@@ -1,5 +1,6 @@
 #include "network/Client.h"
 #include "core.h"
+#include "core/MemoryTracker.h"
 #include "network/Network.h"
 #include "world/ChunkManager.h"
 #include "world/Chunk.hpp"
@@ -153,7 +154,7 @@ namespace Minecraft
 					g_memory_copyMem(&compressedChunkSize, chunkDataPtr, sizeof(uint32));
 					chunkDataPtr += sizeof(uint32);
 
-					Block* chunkData = (Block*)g_memory_allocate(sizeof(Block) * World::ChunkWidth * World::ChunkHeight * World::ChunkDepth);
+					Block* chunkData = (Block*)MemoryTracker::allocate(MemoryTag::Network, sizeof(Block) * World::ChunkWidth * World::ChunkHeight * World::ChunkDepth);
 					g_memory_zeroMem(chunkData, sizeof(Block) * World::ChunkWidth * World::ChunkDepth * World::ChunkHeight);
 					int blockIndex = 0;
 					uint32 chunkByteCounter = 0;
@@ -1,6 +1,7 @@
 #include "network/Network.h"
 #include "network/Server.h"
 #include "network/Client.h"
+#include "core/MemoryTracker.h"
 
 #include <enet/enet.h>
 
@@ -73,7 +74,7 @@ namespace Minecraft
 			NetworkPacket networkPacket = createPacket(eventType, data, dataSizeInBytes);
 			ENetPacket* packet = enet_packet_create(networkPacket.data, networkPacket.size, ENET_PACKET_FLAG_RELIABLE);
 			Server::sendClient(peer, packet);
-			g_memory_free(networkPacket.data);
+			MemoryTracker::free(MemoryTag::Network, networkPacket.data);
 		}
 
 		void broadcast(NetworkEventType eventType, void* data, size_t dataSizeInBytes)
@@ -90,7 +91,7 @@ namespace Minecraft
 				Client::sendServer(packet);
 			}
 
-			g_memory_free(networkPacket.data);
+			MemoryTracker::free(MemoryTag::Network, networkPacket.data);
 		}
 
 		bool isLanServer()
@@ -144,7 +145,7 @@ namespace Minecraft
 			// Copy event and data into the packet
 			size_t eventPlusDataSize = sizeof(NetworkEvent) + dataSizeInBytes;
 			// TODO: Create custom stack based memory allocator for the server messages
-			uint8* eventPlusData = (uint8*)g_memory_allocate(eventPlusDataSize);
+			uint8* eventPlusData = (uint8*)MemoryTracker::allocate(MemoryTag::Network, eventPlusDataSize);
 			NetworkEvent* networkEvent = (NetworkEvent*)eventPlusData;
 			networkEvent->dataSize = dataSizeInBytes;
 			networkEvent->type = eventType;
@@ -1,9 +1,12 @@
 #include "network/Server.h"
 #include "core.h"
 #include "core/Scene.h"
+#include "core/MemoryTracker.h"
 #include "network/Network.h"
 #include "world/ChunkManager.h"
 #include "world/Chunk.hpp"
+#include "world/ChunkDirectory.hpp"
+#include "world/ChunkData.hpp"
 #include "world/BlockMap.h"
 
 #include <enet/enet.h>
@@ -71,22 +74,21 @@ namespace Minecraft
 					g_logger_assert(numConnectedClients <= 32, "Somehow we connected more than the maximum number of clients allowed.");
 
 					g_logger_info("Sending client chunk data.");
-					robin_hood::unordered_node_map<glm::ivec2, Chunk>& chunks = ChunkManager::getAllChunks();
+					ChunkDirectory& chunks = ChunkManager::getAllChunks();
 					Network::sendClient(event.peer, NetworkEventType::WorldSeed, &World::seed, sizeof(uint32));
 					uint16 numChunks = (uint16)chunks.size();
 					size_t chunkDataSize = sizeof(Block) * World::ChunkHeight * World::ChunkWidth * World::ChunkDepth;
 					size_t chunkCoordsSize = sizeof(int32) * 2;
 					size_t chunkStateSize = sizeof(ChunkState);
 					size_t chunkCompressedSizeSize = sizeof(uint32);
-					uint8* chunkDataEvent = (uint8*)g_memory_allocate(sizeof(uint16) + (chunkDataSize * numChunks) + (chunkCoordsSize * numChunks) + (chunkStateSize * numChunks));
+					uint8* chunkDataEvent = (uint8*)MemoryTracker::allocate(MemoryTag::Network, sizeof(uint16) + (chunkDataSize * numChunks) + (chunkCoordsSize * numChunks) + (chunkStateSize * numChunks));
 					g_logger_info("Num chunks: %u", numChunks);
 					g_memory_copyMem(chunkDataEvent, &numChunks, sizeof(uint16));
 					uint8* chunkDataPtr = chunkDataEvent + sizeof(uint16);
 					bool first = true;
-					for (auto& pair : chunks)
+					chunks.forEach([&](Chunk& chunk)
 					{
 						uint32 compressedChunkSize = 0;
-						Chunk& chunk = pair.second;
 						if (chunk.state == ChunkState::Loaded)
 						{
 							// Compressed chunk looks like this
@@ -94,32 +96,47 @@ namespace Minecraft
 							//		   -> blockId(uint16) -> blockCount(uint16)
 							//         -> chunkCoords (int32) * 2 -> chunkState (uint8)
 							uint8* chunkDataCurrentPtr = chunkDataPtr + chunkCompressedSizeSize;
-							uint16 lastBlockId = chunk.data[0].id;
-							uint16 lastBlockCount = 1;
-							for (uint32 i = 1; i < World::ChunkHeight * World::ChunkWidth * World::ChunkDepth; i++)
+							uint16 lastBlockId = chunk.data->getId(0);
+							uint16 lastBlockCount = 0;
+							auto writeRun = [&]()
 							{
-								if (chunk.data[i].id != lastBlockId)
+								g_memory_copyMem(chunkDataCurrentPtr, &lastBlockId, sizeof(uint16));
+								chunkDataCurrentPtr += sizeof(uint16);
+								g_memory_copyMem(chunkDataCurrentPtr, &lastBlockCount, sizeof(uint16));
+								chunkDataCurrentPtr += sizeof(uint16);
+								compressedChunkSize += (sizeof(uint16) * 2);
+							};
+							auto addBlocks = [&](uint16 blockId, uint16 blockCount)
+							{
+								// A run can't hold a whole chunk's worth of blocks, so long runs get split
+								if (blockId != lastBlockId || (uint32)lastBlockCount + blockCount > UINT16_MAX)
 								{
-									// Write to our memory
-									g_memory_copyMem(chunkDataCurrentPtr, &lastBlockId, sizeof(uint16));
-									chunkDataCurrentPtr += sizeof(uint16);
-									g_memory_copyMem(chunkDataCurrentPtr, &lastBlockCount, sizeof(uint16));
-									chunkDataCurrentPtr += sizeof(uint16);
-									compressedChunkSize += (sizeof(uint16) * 2);
-
-									// Set the next id
-									lastBlockId = chunk.data[i].id;
+									writeRun();
+									lastBlockId = blockId;
 									lastBlockCount = 0;
 								}
-								lastBlockCount++;
+								lastBlockCount += blockCount;
+							};
+
+							for (int sectionIndex = 0; sectionIndex < ChunkData::NumSections; sectionIndex++)
+							{
+								// Uniform sections are one run, no need to look at every block
+								uint16 uniformId;
+								if (chunk.data->isSectionUniform(sectionIndex, uniformId))
+								{
+									addBlocks(uniformId, ChunkData::BlocksPerSection);
+									continue;
+								}
+
+								int firstIndex = sectionIndex * ChunkData::BlocksPerSection;
+								for (int i = firstIndex; i < firstIndex + ChunkData::BlocksPerSection; i++)
+								{
+									addBlocks(chunk.data->getId(i), 1);
+								}
 							}
 							if (lastBlockCount > 0)
 							{
-								g_memory_copyMem(chunkDataCurrentPtr, &lastBlockId, sizeof(uint16));
-								chunkDataCurrentPtr += sizeof(uint16);
-								g_memory_copyMem(chunkDataCurrentPtr, &lastBlockCount, sizeof(uint16));
-								chunkDataCurrentPtr += sizeof(uint16);
-								compressedChunkSize += (sizeof(uint16) * 2);
+								writeRun();
 							}
 							g_memory_copyMem(chunkDataPtr, &compressedChunkSize, sizeof(uint32));
 							chunkDataPtr += chunkCompressedSizeSize + compressedChunkSize;
@@ -128,14 +145,15 @@ namespace Minecraft
 							chunkDataPtr += sizeof(int32);
 							g_memory_copyMem(chunkDataPtr, &chunk.chunkCoords.y, sizeof(int32));
 							chunkDataPtr += sizeof(int32);
-							g_memory_copyMem(chunkDataPtr, &chunk.state, sizeof(ChunkState));
+							ChunkState chunkState = chunk.state.load();
+							g_memory_copyMem(chunkDataPtr, &chunkState, sizeof(ChunkState));
 							chunkDataPtr += sizeof(ChunkState);
 						}
-					}
+					});
 					size_t totalCompressedSize = chunkDataPtr - chunkDataEvent;
 					g_logger_info("Total compressed chunk data size: %u bytes", totalCompressedSize);
 					Network::sendClient(event.peer, NetworkEventType::ChunkData, chunkDataEvent, totalCompressedSize);
-					g_memory_free(chunkDataEvent);
+					MemoryTracker::free(MemoryTag::Network, chunkDataEvent);
 
 					g_logger_info("Telling client to patch their dang chunk neighbors.");
 					Network::sendClient(event.peer, NetworkEventType::PatchChunkNeighbors, nullptr, 0);
@@ -202,7 +202,6 @@ namespace Minecraft
 			}
 
 			int blockId = ChunkManager::getBlock(blockCenter).id;
-			BlockFormat block = BlockMap::getBlock(blockId);
 			if (blockId != BlockMap::NULL_BLOCK.id && blockId != BlockMap::AIR_BLOCK.id)
 			{
 				BoxCollider currentBox;
@@ -212,9 +211,7 @@ namespace Minecraft
 				currentTransform.position = blockCenter;
 
 				Block block = ChunkManager::getBlock(currentTransform.position);
-				BlockFormat blockFormat = BlockMap::getBlock(block.id);
-
-				if (blockFormat.isSolid)
+				if (BlockMap::hasProperty(block.id, BlockProperty::Solid))
 				{
 					glm::vec3 min = currentTransform.position - (currentBox.size * 0.5f) + currentBox.offset;
 					glm::vec3 max = currentTransform.position + (currentBox.size * 0.5f) + currentBox.offset;
@@ -280,7 +277,6 @@ namespace Minecraft
 					{
 						glm::vec3 boxPos = glm::vec3(x - 0.5f, y - 0.5f, z - 0.5f);
 						Block block = ChunkManager::getBlock(boxPos);
-						BlockFormat blockFormat = BlockMap::getBlock(block.id);
 
 						BoxCollider defaultBlockCollider;
 						defaultBlockCollider.size = glm::vec3(1.0f, 1.0f, 1.0f);
@@ -292,7 +288,7 @@ namespace Minecraft
 						blockTransform.scale = glm::vec3(1, 1, 1);
 						blockTransform.position = boxPos;
 
-						if (blockFormat.isSolid && isColliding(boxCollider, transform, defaultBlockCollider, blockTransform))
+						if (BlockMap::hasProperty(block.id, BlockProperty::Solid) && isColliding(boxCollider, transform, defaultBlockCollider, blockTransform))
 						{
 							CollisionManifold collision =
 								staticCollisionInformation(rb, boxCollider, transform, defaultBlockCollider, blockTransform);
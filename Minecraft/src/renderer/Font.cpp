@@ -1,4 +1,5 @@
 #include "renderer/Font.h"
+#include "core/MemoryTracker.h"
 
 namespace Minecraft
 {
@@ -224,7 +225,7 @@ namespace Minecraft
 
 		static void generateDefaultCharset(Font& font, CharRange defaultCharset)
 		{
-			uint8* fontBuffer = (uint8*)g_memory_allocate(sizeof(uint8) * font.texture.width * font.texture.height);
+			uint8* fontBuffer = (uint8*)MemoryTracker::allocate(MemoryTag::Fonts, sizeof(uint8) * font.texture.width * font.texture.height);
 			g_memory_zeroMem(fontBuffer, sizeof(uint8) * font.texture.width * font.texture.height);
 			uint32 currentLineHeight = 0;
 			uint32 currentX = 0;
@@ -298,7 +299,7 @@ namespace Minecraft
 			}
 
 			// Flip the texture vertically since OpenGL doesn't like it this direction
-			uint8* flippedBuffer = (uint8*)g_memory_allocate(sizeof(uint8) * font.texture.width * font.texture.height);
+			uint8* flippedBuffer = (uint8*)MemoryTracker::allocate(MemoryTag::Fonts, sizeof(uint8) * font.texture.width * font.texture.height);
 			for (int y = 0; y < font.texture.height; y++)
 			{
 				uint8* srcScanline = fontBuffer + font.texture.width * y;
@@ -313,8 +314,8 @@ namespace Minecraft
 			}
 
 			font.texture.uploadSubImage(0, 0, font.texture.width, font.texture.height, flippedBuffer);
-			g_memory_free(fontBuffer);
-			g_memory_free(flippedBuffer);
+			MemoryTracker::free(MemoryTag::Fonts, fontBuffer);
+			MemoryTracker::free(MemoryTag::Fonts, flippedBuffer);
 		}
 	}
 
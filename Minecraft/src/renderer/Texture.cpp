@@ -1,10 +1,12 @@
 #include "renderer/Texture.h"
+#include "core/MemoryTracker.h"
 
 namespace Minecraft
 {
 	static const uint32 NULL_TEXTURE_ID = UINT32_MAX;
 
 	static void bindTextureParameters(const Texture& texture);
+	static void trackGpuMemory(Texture& texture);
 
 	// ========================================================
 	// 	   Texture Builder
@@ -27,6 +29,7 @@ namespace Minecraft
 		texture.swizzleFormat[2] = ColorChannel::Blue;
 		texture.swizzleFormat[3] = ColorChannel::Alpha;
 		texture.generateMipmap = false;
+		texture.gpuBytes = 0;
 	}
 
 	TextureBuilder::TextureBuilder(const Texture& texture)
@@ -163,6 +166,13 @@ namespace Minecraft
 			graphicsId = NULL_TEXTURE_ID;
 		}
 
+		// Cubemap faces share their cubemap's texture object, but each one still has its own memory
+		if (gpuBytes > 0)
+		{
+			MemoryTracker::remove(MemoryTag::Textures, gpuBytes);
+			gpuBytes = 0;
+		}
+
 		if (path != nullptr && std::strlen(path) > 0)
 		{
 			g_memory_free(path);
@@ -355,6 +365,37 @@ namespace Minecraft
 
 		}
 
+		uint32 getBytesPerPixel(ByteFormat format)
+		{
+			switch (format)
+			{
+			case ByteFormat::RGBA8_UI:
+				return 4;
+			case ByteFormat::RGB8_UI:
+				return 3;
+			case ByteFormat::RGBA_16F:
+				return 8;
+			case ByteFormat::R32_UI:
+				return 4;
+			case ByteFormat::R8_UI:
+				return 1;
+			case ByteFormat::R8_F:
+				return 1;
+			case ByteFormat::R32_F:
+				return 4;
+			case ByteFormat::ALPHA_F:
+				return 1;
+			case ByteFormat::DepthStencil:
+				return 4;
+			case ByteFormat::None:
+				return 0;
+			default:
+				g_logger_warning("Unknown glByteFormat '%d'", format);
+			}
+
+			return 0;
+		}
+
 		bool byteFormatIsRgb(const Texture& texture)
 		{
 			switch (texture.format)
@@ -476,6 +517,7 @@ namespace Minecraft
 			{
 				glGenerateMipmap(textureType);
 			}
+			trackGpuMemory(texture);
 
 			stbi_image_free(pixels);
 		}
@@ -514,6 +556,7 @@ namespace Minecraft
 			default:
 				g_logger_error("Invalid texture type '%d'.", texture.type);
 			}
+			trackGpuMemory(texture);
 		}
 	}
 
@@ -548,4 +591,16 @@ namespace Minecraft
 		//};
 		//glTexParameteriv(type, GL_TEXTURE_SWIZZLE_RGBA, swizzleMask);
 	}
+
+	static void trackGpuMemory(Texture& texture)
+	{
+		size_t height = texture.type == TextureType::_1D ? 1 : (size_t)texture.height;
+		texture.gpuBytes = (size_t)texture.width * height * TextureUtil::getBytesPerPixel(texture.format);
+		if (texture.generateMipmap)
+		{
+			// The whole mip chain adds up to about a third more
+			texture.gpuBytes += texture.gpuBytes / 3;
+		}
+		MemoryTracker::add(MemoryTag::Textures, texture.gpuBytes);
+	}
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "renderer/Styles.h"
 #include "renderer/Renderer.h"
 #include "utils/CMath.h"
+#include "core/MemoryTracker.h"
 #include "world/World.h"
 
 namespace Minecraft
@@ -14,7 +15,6 @@ namespace Minecraft
 		float lastFrameTime = 0.16f;
 		glm::vec3 playerPos = glm::vec3();
 		glm::vec3 playerOrientation = glm::vec3();
-		std::atomic<float> totalChunkRamUsed = 0.0f;
 		float totalChunkRamAvailable = 0.0f;
 		Block blockLookingAt = BlockMap::NULL_BLOCK;
 
@@ -91,8 +91,9 @@ namespace Minecraft
 
 				// Draw third row of statistics
 				playerPosPos = glm::vec2(-2.95f, 1.11f);
+				float totalChunkRamUsed = (float)(MemoryTracker::getCurrent(MemoryTag::ChunkBlocks) + MemoryTracker::getCurrent(MemoryTag::SubChunkVertices));
 				playerPosStr = std::string("Chunk RAM: " + 
-					CMath::toString(DebugStats::totalChunkRamUsed / (1024.0f * 1024.0f)) + 
+					CMath::toString(totalChunkRamUsed / (1024.0f * 1024.0f)) + 
 					std::string("/") + 
 					CMath::toString(DebugStats::totalChunkRamAvailable / (1024.0f * 1024.0f)) +
 					std::string("MB"));
@@ -9,5 +9,19 @@ namespace Minecraft
 			extern glm::vec4 clearColor = "#00000000"_hex;
 			extern const char* title = "Minecraft Clone";
 		}
+
+		namespace Chunks
+		{
+			extern uint32 numWorkerThreads = 0;
+			extern uint32 chunkCacheMegabytes = 256;
+			extern uint32 chunkRadius = 12;
+			extern bool greedyMeshing = true;
+		}
+
+		namespace Memory
+		{
+			extern uint32 chunkBlockBudgetMegabytes = 1536;
+			extern uint32 subChunkVertexBudgetMegabytes = 0;
+		}
 	}
 }
\ No newline at end of file
@@ -28,7 +28,11 @@ namespace Minecraft
 		};
 
 		static robin_hood::unordered_map<std::string, int> nameToIdMap;
-		static robin_hood::unordered_node_map<int16, BlockFormat> blockFormats;
+		// Every format is stored back to back, with the null block's first. Item ids go past 32000, so ids
+		// are mapped into this instead of indexing it directly
+		static std::vector<BlockFormat> blockFormats;
+		static uint16 blockFormatIndices[UINT16_MAX + 1];
+		uint8 blockProperties[UINT16_MAX + 1];
 		static std::vector<CraftingRecipe> craftingRecipes;
 		// TODO: Ensure that these maps never change throughout a gameplay cycle
 		// unless a resource pack is loaded
@@ -39,6 +43,9 @@ namespace Minecraft
 		static uint32 texCoordsTextureId;
 		static uint32 texCoordsBufferId;
 
+		static uint8 packProperties(const BlockFormat& format);
+		static void setBlockFormat(int id, const BlockFormat& format);
+
 		const TextureFormat& getTextureFormat(const std::string& textureName)
 		{
 			const auto& iter = textureFormatMap.find(textureName);
@@ -66,7 +73,7 @@ namespace Minecraft
 		const BlockFormat& getBlock(const std::string& name)
 		{
 			int blockId = getBlockId(name);
-			return blockFormats[blockId];
+			return getBlock(blockId);
 		}
 
 		const int getBlockId(const std::string& name)
@@ -81,11 +88,11 @@ namespace Minecraft
 
 		const BlockFormat& getBlock(int blockId)
 		{
-			if (blockFormats.contains(blockId))
+			if (blockId < 0 || blockId > UINT16_MAX)
 			{
-				return blockFormats[blockId];
+				return blockFormats[0];
 			}
-			return blockFormats[0];
+			return blockFormats[blockFormatIndices[blockId]];
 		}
 
 		void loadBlocks(const char* textureFormatConfig, const char* itemFormatConfig, const char* blockFormatConfig)
@@ -94,7 +101,8 @@ namespace Minecraft
 			YAML::Node blockFormat = YamlExtended::readFile(blockFormatConfig);
 			YAML::Node itemFormat = YamlExtended::readFile(itemFormatConfig);
 
-			blockFormats[0] = {
+			blockFormats.clear();
+			blockFormats.push_back({
 				nullptr,
 				nullptr,
 				nullptr,
@@ -110,7 +118,14 @@ namespace Minecraft
 				true,
 				false,
 				0
-			};
+			});
+			// Until they're loaded, every id is the null block
+			g_memory_zeroMem(blockFormatIndices, sizeof(blockFormatIndices));
+			uint8 nullProperties = packProperties(blockFormats[0]);
+			for (uint8& properties : blockProperties)
+			{
+				properties = nullProperties;
+			}
 
 			if (textureFormat["Blocks"])
 			{
@@ -197,16 +212,11 @@ namespace Minecraft
 						bottomTexture = &bottomTextureIter->second;
 					}
 
-					if (blockFormats.contains(id))
-					{
-						g_logger_warning("Block format detected a duplicate block id '%d'. Do you have two blocks with id '%d'?", id, id);
-					}
-
-					blockFormats[id] = BlockFormat{
+					setBlockFormat(id, BlockFormat{
 						sideTexture, topTexture, bottomTexture, itemPictureName,
 						isTransparent, isSolid, colorTopByBiome, colorSideByBiome, colorBottomByBiome,
 						isBlendable, isLightSource, lightLevel, false, true, 64
-					};
+					});
 				}
 				else
 				{
@@ -216,16 +226,11 @@ namespace Minecraft
 					std::string itemPictureName = block.second["itemPicture"].IsDefined() ? block.second["itemPicture"].as<std::string>() : "null";
 					int maxStackCount = block.second["maxStackCount"].IsDefined() ? block.second["maxStackCount"].as<int>() : 64;
 
-					if (blockFormats.contains(id))
-					{
-						g_logger_warning("Block format detected a duplicate block id '%d'. Do you have two blocks with id '%d'?", id, id);
-					}
-
-					blockFormats[id] = BlockFormat{
+					setBlockFormat(id, BlockFormat{
 						nullptr, nullptr, nullptr, itemPictureName,
 						false, false, false, false, false,
 						false, false, 0, isItem, isStackable, maxStackCount
-					};
+					});
 				}
 			}
 		}
@@ -255,9 +260,9 @@ namespace Minecraft
 						blockItemTextureMap[texture.first.as<std::string>() + "_as_item"] = format;
 
 						int blockId = nameToIdMap[texture.first.as<std::string>()];
-						if (blockId >= 0 && blockId < blockFormats.size())
+						if (blockId >= 0 && blockId <= UINT16_MAX)
 						{
-							BlockFormat& block = blockFormats.at(blockId);
+							BlockFormat& block = blockFormats[blockFormatIndices[blockId]];
 							block.itemPictureName = texture.first.as<std::string>() + "_as_item";
 						}
 					}
@@ -483,6 +488,42 @@ namespace Minecraft
 
 			glViewport(0, 0, Application::getWindow().width, Application::getWindow().height);
 		}
+
+		static uint8 packProperties(const BlockFormat& format)
+		{
+			uint8 properties = 0;
+			properties |= format.isTransparent ? (uint8)BlockProperty::Transparent : 0;
+			properties |= format.isSolid ? (uint8)BlockProperty::Solid : 0;
+			properties |= format.isBlendable ? (uint8)BlockProperty::Blendable : 0;
+			properties |= format.isLightSource ? (uint8)BlockProperty::LightSource : 0;
+			properties |= format.colorTopByBiome ? (uint8)BlockProperty::ColorTopByBiome : 0;
+			properties |= format.colorSideByBiome ? (uint8)BlockProperty::ColorSideByBiome : 0;
+			properties |= format.colorBottomByBiome ? (uint8)BlockProperty::ColorBottomByBiome : 0;
+			properties |= format.isItemOnly ? (uint8)BlockProperty::ItemOnly : 0;
+			return properties;
+		}
+
+		static void setBlockFormat(int id, const BlockFormat& format)
+		{
+			if (id < 0 || id > UINT16_MAX)
+			{
+				g_logger_error("Block id '%d' is out of range, ids have to fit in 16 bits.", id);
+				return;
+			}
+
+			// Id 0 always has the null block's format, so it counts as already defined
+			if (id == 0 || blockFormatIndices[id] != 0)
+			{
+				g_logger_warning("Block format detected a duplicate block id '%d'. Do you have two blocks with id '%d'?", id, id);
+				blockFormats[blockFormatIndices[id]] = format;
+			}
+			else
+			{
+				blockFormatIndices[id] = (uint16)blockFormats.size();
+				blockFormats.push_back(format);
+			}
+			blockProperties[id] = packProperties(format);
+		}
 	}
 
 	bool operator==(const Block& a, const Block& b)
@@ -495,18 +536,4 @@ namespace Minecraft
 		return !(a == b);
 	}
 
-	bool Block::isLightSource() const
-	{
-		return BlockMap::getBlock(id).isLightSource;
-	}
-
-	bool Block::isTransparent() const
-	{
-		return BlockMap::getBlock(id).isTransparent;
-	}
-
-	bool Block::isItemOnly() const
-	{
-		return BlockMap::getBlock(id).isItemOnly;
-	}
 }
@@ -2,12 +2,20 @@
 #include "world/World.h"
 #include "world/BlockMap.h"
 #include "world/Chunk.hpp"
+#include "world/ChunkDirectory.hpp"
+#include "world/ChunkCache.hpp"
+#include "world/ChunkData.hpp"
+#include "world/ChunkSnapshot.hpp"
 #include "world/TerrainGenerator.h"
 #include "core/Pool.hpp"
+#include "core/TlsfAllocator.hpp"
+#include "core/MpscQueue.hpp"
+#include "core/MemoryTracker.h"
 #include "core/File.h"
 #include "utils/DebugStats.h"
 #include "utils/CMath.h"
 #include "utils/Constants.h"
+#include "utils/Settings.h"
 #include "renderer/Shader.h"
 #include "renderer/Renderer.h"
 #include "renderer/Frustum.h"
@@ -15,6 +23,9 @@
 #include "renderer/Texture.h"
 #include "core/Application.h"
 #include "network/Network.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace Minecraft
 {
@@ -22,33 +33,108 @@ namespace Minecraft
 	{
 		SaveBlockData = 0,
 		ClientLoadChunk,
+		LoadBlockData,
 		GenerateTerrain,
 		GenerateDecorations,
 		CalculateLighting,
 		RecalculateLighting,
 		TesselateVertices
 	};
+	static const int NumCommandTypes = (int)CommandType::TesselateVertices + 1;
+
+	// One bit per 16 block tall level of a chunk, the same levels its sub-chunks are split into
+	static const uint16 AllChunkLevels = 0xFFFF;
+
+	// The levels whose meshes can see a block at this height. Faces and smooth lighting reach one block
+	// past the block they belong to, so a block on the edge of a level shows up in the next one too
+	static uint16 getLevelsTouching(int y)
+	{
+		int lowestLevel = glm::max(y - 1, 0) / 16;
+		int highestLevel = glm::min(y + 1, World::ChunkHeight - 1) / 16;
+		uint16 levels = 0;
+		for (int level = lowestLevel; level <= highestLevel; level++)
+		{
+			levels |= (uint16)(1 << level);
+		}
+		return levels;
+	}
 
 	struct FillChunkCommand
 	{
-		// Must be at least ChunkWidth * ChunkDepth * ChunkHeight blocks available
-		Chunk* chunk;
-		Pool<SubChunk, World::ChunkCapacity * 16>* subChunks;
-		glm::ivec2 playerPosChunkCoords;
+		// Must be at least ChunkWidth * ChunkDepth * ChunkHeight blocks available. Pinned until the
+		// command is done with it, so unloading never frees a chunk a worker is still using
+		PinnedChunk chunk;
+		Pool<SubChunk>* subChunks;
+		// Copied out of the chunk so the command can be re-prioritized without touching the chunk
+		glm::ivec2 chunkCoords;
 		CommandType type;
 		glm::vec3 blockThatUpdated;
 		bool removedLightSource;
+		// Which levels a mesh command has to redo
+		uint16 levelsToMesh;
 		void* clientChunkData;
+		// The block pool slot the chunk lives in and that slot's generation when this was queued.
+		// These stay valid after the chunk is gone, so stale commands can be dropped without touching it
+		uint32 chunkSlot;
+		uint32 chunkGeneration;
+	};
+
+	enum class SubChunkEventType : uint8
+	{
+		// A sub-chunk has all of its vertices and can be drawn
+		Uploaded,
+		// A chunk finished meshing, so sub-chunks from its older meshes can be freed
+		MeshFinished
+	};
+
+	struct SubChunkEvent
+	{
+		SubChunkEventType type;
+		uint32 subChunkIndex;
+		uint32 meshVersion;
+		ChunkHandle chunk;
+		// The levels a finished mesh covered. Sub-chunks in any other level are left alone
+		uint16 levels;
+	};
+
+	// What face culling needs to know about each block of a level and the one block border around it. Each
+	// row is one bit per block along z, with bit z + 1 for block z so the border fits on both ends. Rows are
+	// indexed by [y + 1 relative to the level][x + 1]
+	struct FaceMasks
+	{
+		static const int Rows = 16 + 2;
+		static const int Columns = World::ChunkDepth + 2;
+		static const uint32 InsideBits = ((1u << World::ChunkWidth) - 1) << 1;
+
+		// Anything that isn't null or air
+		uint32 drawn[Rows][Columns];
+		uint32 water[Rows][Columns];
+		// Transparent blocks, which show the faces of anything next to them
+		uint32 seeThrough[Rows][Columns];
+		uint32 air[Rows][Columns];
+	};
+
+	// How big a sub-chunk's mesh is isn't known until it's done, so each worker meshes one level of a
+	// chunk in here and then copies it into a vertex buffer allocation of exactly the right size
+	struct MeshScratch
+	{
+		std::vector<Vertex> solidVertices;
+		std::vector<Vertex> blendableVertices;
+		// One entry per face of every block in a level, for the faces greedy meshing can merge. Zero means
+		// there's no face there, and merging clears every entry it uses so this is all zeroes between levels
+		std::vector<uint64> greedyFaces = std::vector<uint64>(6 * World::ChunkWidth * World::ChunkDepth * 16, 0);
+		FaceMasks faceMasks;
 	};
 
 	namespace ChunkPrivate
 	{
 		void generateTerrain(Chunk* chunk, const glm::ivec2& chunkCoordinates, float seed, const SimplexNoise& generator);
-		void generateDecorations(const glm::ivec2& lastPlayerLoadPosChunkCoords, float seed, const SimplexNoise& generator);
+		void generateDecorations(Chunk* chunk, float seed, const SimplexNoise& generator);
 		// Must guarantee at least 16 sub-chunks located at this address
-		void generateRenderData(Pool<SubChunk, World::ChunkCapacity * 16>* subChunks, const Chunk* chunk, const glm::ivec2& chunkCoordinates);
-		void calculateLighting(const glm::ivec2& lastPlayerLoadPosChunkCoords);
-		void calculateLightingUpdate(Chunk* chunk, const glm::ivec2& chunkCoordinates, const glm::vec3& blockPosition, bool removedLightSource, robin_hood::unordered_flat_set<Chunk*>& chunksToRetesselate);
+		void generateRenderData(Pool<SubChunk>* subChunks, const Chunk* chunk, const glm::ivec2& chunkCoordinates, uint32 meshVersion, uint16 levels, ChunkSnapshot& snapshot, MeshScratch& meshScratch);
+		void calculateLighting(Chunk* chunk, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate, ChunkSnapshot& snapshot);
+		void calculateLightingUpdate(Chunk* chunk, const glm::ivec2& chunkCoordinates, const glm::vec3& blockPosition, bool removedLightSource, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate);
+		void spreadCachedLight(Chunk* chunk, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate);
 
 		Block getLocalBlock(const glm::ivec3& localPosition, const glm::ivec2& chunkCoordinates, const Chunk* blockData);
 		Block getBlock(const glm::vec3& worldPosition, const glm::ivec2& chunkCoordinates, const Chunk* blockData);
@@ -57,56 +143,128 @@ namespace Minecraft
 		bool removeLocalBlock(const glm::ivec3& localPosition, const glm::ivec2& chunkCoordinates, Chunk* blockData);
 		bool removeBlock(const glm::vec3& worldPosition, const glm::ivec2& chunkCoordinates, Chunk* blockData);
 
-		void serialize(const std::string& worldSavePath, const Block* blockData, const glm::ivec2& chunkCoordinates);
-		void deserialize(Block* blockData, const std::string& worldSavePath, const glm::ivec2& chunkCoordinates);
+		// Bit i of uniformSections is set when section i is all one block id
+		void serialize(const std::string& worldSavePath, const Block* blockData, uint16 uniformSections, const glm::ivec2& chunkCoordinates);
+		// Returns false if the file is missing, truncated or corrupt. The chunk data is left cleared
+		bool deserialize(ChunkData* chunkData, const std::string& worldSavePath, const glm::ivec2& chunkCoordinates);
 
 		bool exists(const std::string& worldSavePath, const glm::ivec2& chunkCoordinates);
 		void info();
 	}
 
-	class CompareFillChunkCommand
-	{
-	public:
-		// Returning true means lesser priority
-		bool operator()(const FillChunkCommand& a, const FillChunkCommand& b)
-		{
-			if (a.type != b.type)
-			{
-				// Order of priorities is listed in the CommandType least to greatest
-				return (uint8)a.type > (uint8)b.type;
-			}
-
-			if (a.type != CommandType::CalculateLighting && a.type != CommandType::GenerateDecorations)
-			{
-				// They are the same type of command, the chunk closer to the player has higher priority
-				glm::ivec2 tmpA = a.playerPosChunkCoords - a.chunk->chunkCoords;
-				int32 aDistanceSquared = (tmpA.x * tmpA.x) + (tmpA.y * tmpA.y);
-				glm::ivec2 tmpB = b.playerPosChunkCoords - b.chunk->chunkCoords;
-				int32 bDistanceSquared = (tmpB.x * tmpB.x) + (tmpB.y * tmpB.y);
-				return aDistanceSquared > bDistanceSquared;
-			}
-
-			return false;
-		}
-	};
-
 	namespace ChunkManager
 	{
 		bool doStepLogic = false;
 
+		// Internal functions
+		static void completeChunkStage(Chunk* chunk, ChunkStage stage);
+		static void markChunkDecorated(Chunk* chunk);
+		static uint32 getChunkSlot(const Chunk* chunk);
+		static void tagChunkCommand(FillChunkCommand& command);
+		static bool isCommandStale(const FillChunkCommand& command);
+		static void queueSubChunkEvent(const SubChunkEvent& event);
+		static void processSubChunkEvents();
+		static void queueRetesselateLevels(Chunk* chunk, uint16 levels);
+		static bool allocateSubChunkVertices(SubChunk* subChunk, uint32 numVertices);
+		static Vertex* getSubChunkVertices(const SubChunk* subChunk);
+
 		class ChunkWorker
 		{
 		public:
-			ChunkWorker()
-				: cv(), mtx(), queueMtx(), doWork(true)
+			// Bucket 0 is for commands that always go first, the rest are ranked by distance to the player.
+			// There are enough for the biggest render distance, so changing it never has to touch the queues
+			static const int NumPriorityBuckets = (World::MaxChunkRadius * 4) + 2;
+			// The camera turns every frame, but the queues only need to follow it this often
+			static constexpr std::chrono::milliseconds FrustumRankInterval = std::chrono::milliseconds(250);
+			// Chunk positions map onto a grid of locks this wide. The load area always fits inside it, so two
+			// loaded chunks only ever share a lock when one of them is already far outside it
+			static const int ChunkLockStride = World::MaxChunkRadius * 2;
+			static_assert((ChunkLockStride & (ChunkLockStride - 1)) == 0, "The chunk lock stride must be a power of two.");
+
+			// Locks every chunk position within the radius of the center, even ones with no chunk yet, so a
+			// chunk that shows up in the middle of a command is covered too. The locks are always taken in
+			// index order, which keeps two commands with overlapping neighborhoods from deadlocking
+			class NeighborhoodLock
 			{
-				noiseGenerators[0] = SimplexNoise();// World::seedAsFloat.load());
-				noiseGenerators[1] = SimplexNoise(World::seedAsFloat.load());
-				noiseGenerators[2] = SimplexNoise(World::seedAsFloat.load());
-				noiseGenerators[3] = SimplexNoise(World::seedAsFloat.load());
-				noiseGenerators[4] = SimplexNoise(World::seedAsFloat.load());
+			public:
+				NeighborhoodLock(ChunkWorker& worker, const glm::ivec2& center, int radius, bool exclusive)
+					: worker(worker), numLocks(0), exclusive(exclusive)
+				{
+					g_logger_assert(radius >= 0 && radius <= 1, "Commands never reach further than the chunks right around them.");
+					for (int z = -radius; z <= radius; z++)
+					{
+						for (int x = -radius; x <= radius; x++)
+						{
+							uint32 lockIndex = getChunkLockIndex(center + glm::ivec2(x, z));
+							if (std::find(lockIndices.begin(), lockIndices.begin() + numLocks, lockIndex) == lockIndices.begin() + numLocks)
+							{
+								lockIndices[numLocks++] = lockIndex;
+							}
+						}
+					}
+					std::sort(lockIndices.begin(), lockIndices.begin() + numLocks);
+
+					for (int i = 0; i < numLocks; i++)
+					{
+						if (exclusive)
+						{
+							worker.chunkLocks[lockIndices[i]].lock();
+						}
+						else
+						{
+							worker.chunkLocks[lockIndices[i]].lock_shared();
+						}
+					}
+				}
+
+				~NeighborhoodLock()
+				{
+					for (int i = numLocks - 1; i >= 0; i--)
+					{
+						if (exclusive)
+						{
+							worker.chunkLocks[lockIndices[i]].unlock();
+						}
+						else
+						{
+							worker.chunkLocks[lockIndices[i]].unlock_shared();
+						}
+					}
+				}
+
+				NeighborhoodLock(const NeighborhoodLock&) = delete;
+				NeighborhoodLock& operator=(const NeighborhoodLock&) = delete;
 
-				workerThread = std::thread(&ChunkWorker::threadWorker, this);
+			private:
+				ChunkWorker& worker;
+				std::array<uint32, 9> lockIndices;
+				int numLocks;
+				bool exclusive;
+			};
+
+			ChunkWorker(uint32 numThreads)
+				: cv(), mtx(), doWork(true)
+			{
+				this->numThreads = numThreads;
+				queues = new WorkerQueue[numThreads];
+				numQueuedCommands = 0;
+				numPendingCommands = 0;
+				for (CommandStats& stats : commandStats)
+				{
+					stats.count = 0;
+					stats.nanoseconds = 0;
+				}
+				playerPosChunkCoords = glm::ivec2(0, 0);
+				priorityEpoch = 0;
+				hasCameraFrustum = false;
+				lastFrustumRank = std::chrono::steady_clock::time_point();
+
+				workerThreads.reserve(numThreads);
+				for (uint32 i = 0; i < numThreads; i++)
+				{
+					workerThreads.emplace_back(&ChunkWorker::threadWorker, this, i);
+				}
+				ioThread = std::thread(&ChunkWorker::ioWorker, this);
 			}
 
 			void free()
@@ -117,141 +275,261 @@ namespace Minecraft
 				}
 				cv.notify_all();
 
-				workerThread.join();
+				{
+					std::lock_guard<std::mutex> lock(ioMtx);
+				}
+				ioCv.notify_all();
+
+				// Commands that are still running push sub-chunk events to us. If we stopped taking them a
+				// full event queue would leave those workers waiting on us while we wait on them
+				while (numPendingCommands > 0)
+				{
+					processSubChunkEvents();
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+
+				for (std::thread& workerThread : workerThreads)
+				{
+					workerThread.join();
+				}
+				workerThreads.clear();
+				ioThread.join();
+
+				delete[] queues;
+				queues = nullptr;
 			}
 
-			void threadWorker()
+			void threadWorker(uint32 threadIndex)
 			{
-				bool shouldContinue = true;
-				while (shouldContinue)
+				std::array<SimplexNoise, 5> noiseGenerators;
+				noiseGenerators[0] = SimplexNoise();// World::seedAsFloat.load());
+				noiseGenerators[1] = SimplexNoise(World::seedAsFloat.load());
+				noiseGenerators[2] = SimplexNoise(World::seedAsFloat.load());
+				noiseGenerators[3] = SimplexNoise(World::seedAsFloat.load());
+				noiseGenerators[4] = SimplexNoise(World::seedAsFloat.load());
+				// Scratch space for meshing and lighting
+				ChunkSnapshot* snapshot = new ChunkSnapshot();
+				MeshScratch* meshScratch = new MeshScratch();
+
+				while (true)
 				{
-					if (commands.empty())
+					FillChunkCommand command;
+					if (!popCommand(threadIndex, command))
 					{
 						// Wait until we need to do some work
 						std::unique_lock<std::mutex> lock(mtx);
-						if (doWork)
-						{
-							cv.wait(lock, [&] { return (!doWork || !commands.empty()) && !waitingOnCommand; });
-							shouldContinue = true;
-						}
-						else
+						if (!doWork && numPendingCommands == 0)
 						{
-							shouldContinue = false;
+							break;
 						}
+
+						cv.wait(lock, [&] { return (!doWork && numPendingCommands == 0) || numQueuedCommands > 0; });
+						continue;
 					}
 
-					FillChunkCommand command;
-					bool processCommand = false;
+					if (isCommandStale(command))
 					{
-						std::lock_guard<std::mutex> queueLock(queueMtx);
-						if (!commands.empty())
+						// The chunk was queued for saving (or is already gone) since this was queued, so
+						// the work would be thrown away anyway. Don't touch the chunk, it may not exist
+						if (command.type == CommandType::ClientLoadChunk)
 						{
-							// Only process all commands if we're not stopping the thread worker.
-							// If we are stopping the thread worker, then only process save commands
-							do
-							{
-								command = commands.top();
-								commands.pop();
-								processCommand = (!doWork && command.type == CommandType::SaveBlockData) || doWork;
-							} while (!doWork && command.type != CommandType::SaveBlockData && commands.size() > 0);
+							MemoryTracker::free(MemoryTag::Network, command.clientChunkData);
 						}
 					}
-
-					if (processCommand)
+					else
 					{
-						switch (command.type)
+						if (isCoalescedCommand(command.type))
 						{
-						case CommandType::ClientLoadChunk:
-						{
-							g_logger_assert(command.clientChunkData != nullptr, "Invalid client data sent to the chunk.");
-							g_memory_copyMem(command.chunk->data, command.clientChunkData,
-								sizeof(Block) * World::ChunkWidth * World::ChunkDepth * World::ChunkHeight);
-							g_memory_free(command.clientChunkData);
-							command.chunk->needsToGenerateDecorations = false;
-							command.chunk->needsToCalculateLighting = true;
-							break;
+							// Clear this before running so any change made while the command is running queues it again
+							command.chunk->queuedCommands.fetch_and((uint8)~(1 << (uint8)command.type));
 						}
-						case CommandType::GenerateTerrain:
+
+						// Saves all go through the I/O thread, so once we're stopping nothing here needs to run
+						if (doWork)
 						{
-							if (ChunkPrivate::exists(World::chunkSavePath, command.chunk->chunkCoords))
-							{
-								ChunkPrivate::deserialize(command.chunk->data, World::chunkSavePath, command.chunk->chunkCoords);
-								command.chunk->needsToGenerateDecorations = false;
-							}
-							else
+							CommandType type = command.type;
+							auto start = std::chrono::steady_clock::now();
 							{
-								ChunkPrivate::generateTerrain(command.chunk, command.chunk->chunkCoords, World::seedAsFloat, noiseGenerators[0]);
-								command.chunk->needsToGenerateDecorations = true;
+								NeighborhoodLock chunkLock(*this, command.chunkCoords, getLockRadius(type), isExclusiveCommand(type));
+								processCommand(command, noiseGenerators, *snapshot, *meshScratch);
 							}
-							command.chunk->needsToCalculateLighting = true;
+							recordCommandTime(type, start);
 						}
-						break;
-						case CommandType::GenerateDecorations:
+						else if (command.type == CommandType::ClientLoadChunk)
 						{
-							ChunkPrivate::generateDecorations(command.playerPosChunkCoords, World::seedAsFloat, noiseGenerators[0]);
+							// Dropped because we're shutting down, but the block data from the server is still ours to free
+							MemoryTracker::free(MemoryTag::Network, command.clientChunkData);
 						}
-						break;
-						case CommandType::CalculateLighting:
+					}
+
+					numPendingCommands--;
+
+					// Finishing a command may have queued the next stage of its neighbors, so wake any sleeping workers
+					{
+						std::lock_guard<std::mutex> lock(mtx);
+					}
+					cv.notify_all();
+
+					if (!doWork)
+					{
+						// The I/O thread also waits for the last command to finish before it shuts down
 						{
-							ChunkPrivate::calculateLighting(command.playerPosChunkCoords);
+							std::lock_guard<std::mutex> lock(ioMtx);
 						}
-						break;
-						case CommandType::RecalculateLighting:
+						ioCv.notify_all();
+					}
+				}
+
+				delete snapshot;
+				delete meshScratch;
+			}
+
+			void ioWorker()
+			{
+				// Scratch space for saves, so the chunk data lock isn't held while we wait on the disk
+				Block* saveBuffer = (Block*)g_memory_allocate(sizeof(Block) * World::ChunkWidth * World::ChunkDepth * World::ChunkHeight);
+
+				while (true)
+				{
+					FillChunkCommand command;
+					{
+						std::unique_lock<std::mutex> lock(ioMtx);
+						ioCv.wait(lock, [&] { return !ioCommands.empty() || (!doWork && numPendingCommands == 0); });
+						if (ioCommands.empty())
 						{
-							robin_hood::unordered_flat_set<Chunk*> chunksToRetesselate = {};
-							ChunkPrivate::calculateLightingUpdate(command.chunk, command.chunk->chunkCoords, command.blockThatUpdated, command.removedLightSource, chunksToRetesselate);
-							for (Chunk* chunk : chunksToRetesselate)
-							{
-								// TODO: I should probably do all this from within the thread...
-								ChunkManager::queueRetesselateChunk(chunk->chunkCoords, chunk);
-								//command.chunk = chunk;
-								//command.type = CommandType::TesselateVertices;
-								//queueCommand(command);
-							}
+							break;
 						}
-						break;
-						case CommandType::TesselateVertices:
+
+						// Saves first, then the closest chunk. A linear scan is nothing next to the disk
+						glm::ivec2 playerPos = playerPosChunkCoords;
+						auto next = ioCommands.begin();
+						for (auto iter = ioCommands.begin(); iter != ioCommands.end(); iter++)
 						{
-							ChunkPrivate::generateRenderData(command.subChunks, command.chunk, command.chunk->chunkCoords);
+							if (getIoPriority(*iter, playerPos) < getIoPriority(*next, playerPos))
+							{
+								next = iter;
+							}
 						}
-						break;
-						case CommandType::SaveBlockData:
+						command = *next;
+						ioCommands.erase(next);
+					}
+
+					if (!isCommandStale(command))
+					{
+						auto start = std::chrono::steady_clock::now();
+						if (command.type == CommandType::SaveBlockData)
 						{
-							// Unload all sub-chunks
-							for (int i = 0; i < (int)command.subChunks->size(); i++)
+							// Chunks that haven't changed since they were loaded are already on disk
+							bool needsSave = false;
+							uint16 uniformSections = 0;
+							if (command.chunk->stage != ChunkStage::Empty)
 							{
-								if ((*command.subChunks)[i]->state == SubChunkState::Uploaded && (*command.subChunks)[i]->chunkCoordinates == command.chunk->chunkCoords)
+								NeighborhoodLock chunkLock(*this, command.chunkCoords, 0, false);
+								needsSave = command.chunk->data->isModified();
+								if (needsSave)
 								{
-									(*command.subChunks)[i]->state = SubChunkState::Unloaded;
-									(*command.subChunks)[i]->numVertsUsed = 0;
-									command.subChunks->freePool(i);
-									DebugStats::totalChunkRamUsed = DebugStats::totalChunkRamUsed - (World::MaxVertsPerSubChunk * sizeof(Vertex));
+									command.chunk->data->copyTo(saveBuffer);
+									command.chunk->data->clearModified();
+									for (int sectionIndex = 0; sectionIndex < ChunkData::NumSections; sectionIndex++)
+									{
+										uint16 uniformId;
+										if (command.chunk->data->isSectionUniform(sectionIndex, uniformId))
+										{
+											uniformSections |= (uint16)(1 << sectionIndex);
+										}
+									}
 								}
 							}
 
-							// Serialize block data
-							ChunkPrivate::serialize(World::chunkSavePath, command.chunk->data, command.chunk->chunkCoords);
-
-							// Tell the chunk manager we are done
-							command.chunk->state = ChunkState::Unloading;
+							if (needsSave)
+							{
+								ChunkPrivate::serialize(World::chunkSavePath, saveBuffer, uniformSections, command.chunk->chunkCoords);
+							}
+							// The main thread frees the chunk as soon as it sees this, so everything above has to be
+							// visible to it first
+							command.chunk->state.store(ChunkState::Unloading, std::memory_order_release);
+							recordCommandTime(CommandType::SaveBlockData, start);
 						}
-						break;
+						else if (doWork)
+						{
+							bool loaded;
+							{
+								NeighborhoodLock chunkLock(*this, command.chunkCoords, 0, true);
+								loaded = loadSavedChunk(command.chunk);
+							}
+							recordCommandTime(CommandType::LoadBlockData, start);
+							if (!loaded)
+							{
+								// Nothing on disk, so hand the chunk to the CPU workers to generate
+								command.type = CommandType::GenerateTerrain;
+								queueCommand(command);
+							}
 						}
 					}
+
+					numPendingCommands--;
+					{
+						std::lock_guard<std::mutex> lock(mtx);
+					}
+					cv.notify_all();
 				}
+
+				g_memory_free(saveBuffer);
 			}
 
 			void queueCommand(FillChunkCommand& command)
 			{
-				command.playerPosChunkCoords = playerPosChunkCoords.load();
+				if (command.type == CommandType::TesselateVertices)
+				{
+					// Done before the merge below, so whichever mesh command runs next picks these levels up
+					command.chunk->levelsToMesh.fetch_or(command.levelsToMesh);
+				}
+
+				if (isCoalescedCommand(command.type))
+				{
+					// If this chunk already has one of these waiting, that command will see the
+					// latest block data when it runs, so there's no need to queue another one
+					uint8 commandBit = (uint8)(1 << (uint8)command.type);
+					if (command.chunk->queuedCommands.fetch_or(commandBit) & commandBit)
+					{
+						return;
+					}
+				}
+
+				command.chunkCoords = command.chunk->chunkCoords;
+				tagChunkCommand(command);
+
+				// The counters are bumped before the command is visible so a worker can never pop it
+				// and finish it before it's been counted
+				numPendingCommands++;
+				if (command.type == CommandType::SaveBlockData || command.type == CommandType::LoadBlockData)
+				{
+					// Disk work always waits for the I/O thread, even when it's falling behind. Handing it to
+					// the CPU workers would just stall them on the disk too
+					{
+						std::lock_guard<std::mutex> lock(ioMtx);
+						ioCommands.push_back(command);
+					}
+					ioCv.notify_one();
+					return;
+				}
+				numQueuedCommands++;
+
+				WorkerQueue& queue = queues[nextQueue++ % numThreads];
 				{
-					std::lock_guard<std::mutex> lockGuard(queueMtx);
-					commands.push(command);
+					std::lock_guard<std::mutex> queueLock(queue.mtx);
+					rankQueue(queue);
+					queue.buckets[getPriorityBucket(command, queue.rankedPlayerPos, queue.rankedFrustum, queue.rankedWithFrustum)].push_back(command);
 				}
 			}
 
 			void beginWork(bool notifyAll = true)
 			{
+				// Lock and release the mutex so a worker that is about to wait can't miss this notification
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+				}
+
 				if (notifyAll)
 				{
 					cv.notify_all();
@@ -264,92 +542,466 @@ namespace Minecraft
 
 			void setPlayerPosChunkCoords(const glm::ivec2& playerPosChunkCoords)
 			{
-				this->playerPosChunkCoords = playerPosChunkCoords;
+				if (this->playerPosChunkCoords.exchange(playerPosChunkCoords) != playerPosChunkCoords)
+				{
+					// Every queue gets re-ranked the next time it's touched
+					priorityEpoch++;
+				}
 			}
 
-		private:
-			std::priority_queue<FillChunkCommand, std::vector<FillChunkCommand>, CompareFillChunkCommand> commands;
-			std::thread workerThread;
-			std::atomic<glm::ivec2> playerPosChunkCoords;
-			std::condition_variable cv;
-			std::mutex mtx;
-			std::mutex queueMtx;
-			bool doWork;
-			std::atomic<bool> waitingOnCommand = false;
-
-			std::array<SimplexNoise, 5> noiseGenerators;
-		};
+			void setCameraFrustum(const glm::ivec2& playerPosChunkCoords, const Frustum& cameraFrustum)
+			{
+				bool hadCameraFrustum;
+				{
+					std::lock_guard<std::mutex> lock(cameraMtx);
+					this->cameraFrustum = cameraFrustum;
+					hadCameraFrustum = hasCameraFrustum;
+					hasCameraFrustum = true;
+				}
 
-		struct DrawCommand
-		{
-			DrawArraysIndirectCommand command;
-			int distanceToPlayer;
-			int level;
-		};
+				// Re-ranking walks every queued command, so moving to a new chunk does it right away and
+				// just looking around waits for the interval. Queues ranked in between see the new frustum anyway
+				auto now = std::chrono::steady_clock::now();
+				bool movedChunks = this->playerPosChunkCoords.exchange(playerPosChunkCoords) != playerPosChunkCoords;
+				if (movedChunks || !hadCameraFrustum || now - lastFrustumRank >= FrustumRankInterval)
+				{
+					lastFrustumRank = now;
+					priorityEpoch++;
+				}
+			}
 
-		namespace DrawCommandUtil
-		{
-			bool operator<(const DrawCommand& a, const DrawCommand& b)
+			glm::ivec2 getPlayerPosChunkCoords() const
 			{
-				return a.distanceToPlayer < b.distanceToPlayer;
+				return playerPosChunkCoords.load();
 			}
 
-			static bool operator>(const DrawCommand& a, const DrawCommand& b)
+			// Chunk data only supports one writer at a time, so anything outside the workers that edits
+			// blocks has to hold the chunks it touches
+			NeighborhoodLock lockChunks(const glm::ivec2& chunkCoords, int radius)
 			{
-				return a.distanceToPlayer > b.distanceToPlayer;
+				return NeighborhoodLock(*this, chunkCoords, radius, true);
 			}
-		}
 
-		class CommandBufferContainer
-		{
-		public:
-			CommandBufferContainer(int maxNumCommands, bool isTransparent)
+			void logCommandStats() const
 			{
-				this->maxNumCommands = maxNumCommands;
-				this->isTransparent = isTransparent;
-				commandBuffer = nullptr;
-				chunkPosBuffer = nullptr;
-				biomeBuffer = nullptr;
-				numCommands = 0;
+				// These are summed across every thread, so they can add up to more than the wall clock time
+				for (int i = 0; i < NumCommandTypes; i++)
+				{
+					uint32 count = commandStats[i].count;
+					if (count == 0)
+					{
+						continue;
+					}
+
+					double totalMs = (double)commandStats[i].nanoseconds / 1'000'000.0;
+					g_logger_info("%s: %u commands, %2.3f ms total, %2.3f ms average.",
+						getCommandName((CommandType)i), count, totalMs, totalMs / (double)count);
+				}
 			}
 
-			void init()
+		private:
+			struct CommandStats
 			{
-				this->commandBuffer = (DrawCommand*)g_memory_allocate(sizeof(DrawCommand) * maxNumCommands);
-				this->chunkPosBuffer = (int32*)g_memory_allocate(sizeof(int32) * maxNumCommands * 2);
-				this->biomeBuffer = (int32*)g_memory_allocate(sizeof(int32) * maxNumCommands);
-				this->numCommands = 0;
+				std::atomic<uint32> count;
+				std::atomic<uint64> nanoseconds;
+			};
+
+			struct WorkerQueue
+			{
+				std::mutex mtx;
+				// Lower buckets are more important. Each bucket is first in first out
+				std::array<std::deque<FillChunkCommand>, NumPriorityBuckets> buckets;
+				// The camera the buckets were last ranked with
+				uint32 rankedEpoch = UINT32_MAX;
+				glm::ivec2 rankedPlayerPos;
+				Frustum rankedFrustum;
+				bool rankedWithFrustum = false;
+			};
+
+			static int getPriorityBucket(const FillChunkCommand& command, const glm::ivec2& playerPos, const Frustum& frustum, bool useFrustum)
+			{
+				// Saves free up block data for new chunks, and lighting updates come from the player editing blocks
+				if (command.type == CommandType::SaveBlockData || command.type == CommandType::RecalculateLighting)
+				{
+					return 0;
+				}
+
+				glm::ivec2 distance = command.chunkCoords - playerPos;
+				int ring = (int)glm::sqrt((float)((distance.x * distance.x) + (distance.y * distance.y)));
+				if (useFrustum && ring > 1)
+				{
+					// Chunks the player can't see are ranked as if they were twice as far away
+					glm::vec3 chunkMin = glm::vec3(command.chunkCoords.x * World::ChunkDepth, 0.0f, command.chunkCoords.y * World::ChunkWidth);
+					glm::vec3 chunkMax = chunkMin + glm::vec3(World::ChunkDepth, World::ChunkHeight, World::ChunkWidth);
+					if (!frustum.isBoxVisible(chunkMin, chunkMax))
+					{
+						ring *= 2;
+					}
+				}
+
+				return glm::min(ring + 1, NumPriorityBuckets - 1);
 			}
 
-			void free()
+			// Must be called with the queue locked
+			void rankQueue(WorkerQueue& queue)
 			{
-				if (commandBuffer)
+				uint32 epoch = priorityEpoch;
+				if (queue.rankedEpoch == epoch)
 				{
-					g_memory_free(commandBuffer);
-					commandBuffer = nullptr;
+					return;
 				}
 
-				if (chunkPosBuffer)
+				queue.rankedEpoch = epoch;
+				queue.rankedPlayerPos = playerPosChunkCoords;
 				{
-					g_memory_free(chunkPosBuffer);
-					chunkPosBuffer = nullptr;
+					std::lock_guard<std::mutex> lock(cameraMtx);
+					queue.rankedFrustum = cameraFrustum;
+					queue.rankedWithFrustum = hasCameraFrustum;
 				}
 
-				if (biomeBuffer)
+				std::array<std::deque<FillChunkCommand>, NumPriorityBuckets> oldBuckets;
+				std::swap(oldBuckets, queue.buckets);
+				for (std::deque<FillChunkCommand>& bucket : oldBuckets)
 				{
-					g_memory_free(biomeBuffer);
-					biomeBuffer = nullptr;
+					for (const FillChunkCommand& command : bucket)
+					{
+						queue.buckets[getPriorityBucket(command, queue.rankedPlayerPos, queue.rankedFrustum, queue.rankedWithFrustum)].push_back(command);
+					}
 				}
 			}
 
-			void add(const DrawArraysIndirectCommand& command, const glm::ivec2& chunkCoords, int level, const glm::ivec2& playerPosChunkCoords, int biome)
+			void recordCommandTime(CommandType type, std::chrono::steady_clock::time_point start)
 			{
-				g_logger_assert((numCommands + 1) < maxNumCommands, "Ran out of room in command buffer!");
-				glm::ivec2 d = chunkCoords - playerPosChunkCoords;
-				int dSquared = (d.x * d.x) + (d.y * d.y);
-				commandBuffer[numCommands] = { command, dSquared, level };
-				commandBuffer[numCommands].command.baseInstance = numCommands;
-				chunkPosBuffer[(numCommands * 2)] = chunkCoords.x;
+				auto elapsed = std::chrono::steady_clock::now() - start;
+				CommandStats& stats = commandStats[(int)type];
+				stats.count++;
+				stats.nanoseconds += (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+			}
+
+			static const char* getCommandName(CommandType type)
+			{
+				switch (type)
+				{
+				case CommandType::SaveBlockData:
+					return "SaveBlockData";
+				case CommandType::ClientLoadChunk:
+					return "ClientLoadChunk";
+				case CommandType::LoadBlockData:
+					return "LoadBlockData";
+				case CommandType::GenerateTerrain:
+					return "GenerateTerrain";
+				case CommandType::GenerateDecorations:
+					return "GenerateDecorations";
+				case CommandType::CalculateLighting:
+					return "CalculateLighting";
+				case CommandType::RecalculateLighting:
+					return "RecalculateLighting";
+				case CommandType::TesselateVertices:
+					return "TesselateVertices";
+				}
+
+				return "Unknown";
+			}
+
+			static int getIoPriority(const FillChunkCommand& command, const glm::ivec2& playerPos)
+			{
+				if (command.type == CommandType::SaveBlockData)
+				{
+					return -1;
+				}
+
+				glm::ivec2 distance = command.chunkCoords - playerPos;
+				return (distance.x * distance.x) + (distance.y * distance.y);
+			}
+
+			// Loads the chunk from disk if it was saved before. Returns false if it still needs to be generated
+			static bool loadSavedChunk(Chunk* chunk)
+			{
+				if (!ChunkPrivate::exists(World::chunkSavePath, chunk->chunkCoords))
+				{
+					return false;
+				}
+
+				if (!ChunkPrivate::deserialize(chunk->data, World::chunkSavePath, chunk->chunkCoords))
+				{
+					// Better to generate it again than to show a chunk with half its blocks missing
+					return false;
+				}
+
+				// Saved chunks already have their decorations
+				completeChunkStage(chunk, ChunkStage::Decorated);
+				return true;
+			}
+
+			// Commands that only depend on the chunk they were queued for and not on any data stored in the
+			// command itself. Recalculating lighting needs the block that changed, and client chunk
+			// loads own their block data, so those are never merged
+			static bool isCoalescedCommand(CommandType type)
+			{
+				return type == CommandType::GenerateTerrain ||
+					type == CommandType::GenerateDecorations ||
+					type == CommandType::CalculateLighting ||
+					type == CommandType::TesselateVertices;
+			}
+
+			// Everything but meshing writes block data or light, so it needs its chunks to itself
+			static bool isExclusiveCommand(CommandType type)
+			{
+				return type != CommandType::TesselateVertices;
+			}
+
+			// Generating terrain and client loads only ever touch their own chunk. Everything else reaches
+			// into the chunks around it (decorations spilling over, light flooding across borders, meshes
+			// reading their neighbors' edges), but never any further than that
+			static int getLockRadius(CommandType type)
+			{
+				return type == CommandType::GenerateTerrain || type == CommandType::ClientLoadChunk ? 0 : 1;
+			}
+
+			static uint32 getChunkLockIndex(const glm::ivec2& chunkCoords)
+			{
+				uint32 x = (uint32)chunkCoords.x & (ChunkLockStride - 1);
+				uint32 z = (uint32)chunkCoords.y & (ChunkLockStride - 1);
+				return x + z * ChunkLockStride;
+			}
+
+			bool popCommand(uint32 threadIndex, FillChunkCommand& outCommand)
+			{
+				// Take the most important command from our own queue first
+				{
+					WorkerQueue& queue = queues[threadIndex];
+					std::lock_guard<std::mutex> queueLock(queue.mtx);
+					rankQueue(queue);
+					for (int bucket = 0; bucket < NumPriorityBuckets; bucket++)
+					{
+						if (!queue.buckets[bucket].empty())
+						{
+							outCommand = queue.buckets[bucket].front();
+							queue.buckets[bucket].pop_front();
+							numQueuedCommands--;
+							return true;
+						}
+					}
+				}
+
+				// Otherwise steal the least important command from another worker
+				for (uint32 i = 1; i < numThreads; i++)
+				{
+					WorkerQueue& queue = queues[(threadIndex + i) % numThreads];
+					std::lock_guard<std::mutex> queueLock(queue.mtx);
+					rankQueue(queue);
+					for (int bucket = NumPriorityBuckets - 1; bucket >= 0; bucket--)
+					{
+						if (!queue.buckets[bucket].empty())
+						{
+							outCommand = queue.buckets[bucket].back();
+							queue.buckets[bucket].pop_back();
+							numQueuedCommands--;
+							return true;
+						}
+					}
+				}
+
+				return false;
+			}
+
+			void processCommand(FillChunkCommand& command, const std::array<SimplexNoise, 5>& noiseGenerators, ChunkSnapshot& snapshot, MeshScratch& meshScratch)
+			{
+				switch (command.type)
+				{
+				case CommandType::ClientLoadChunk:
+				{
+					g_logger_assert(command.clientChunkData != nullptr, "Invalid client data sent to the chunk.");
+					command.chunk->data->copyFrom((const Block*)command.clientChunkData);
+					MemoryTracker::free(MemoryTag::Network, command.clientChunkData);
+					// The server already decorated this chunk
+					completeChunkStage(command.chunk, ChunkStage::Decorated);
+					break;
+				}
+				case CommandType::GenerateTerrain:
+				{
+					ChunkPrivate::generateTerrain(command.chunk, command.chunk->chunkCoords, World::seedAsFloat, noiseGenerators[0]);
+					completeChunkStage(command.chunk, ChunkStage::Generated);
+				}
+				break;
+				case CommandType::GenerateDecorations:
+				{
+					ChunkPrivate::generateDecorations(command.chunk, World::seedAsFloat, noiseGenerators[0]);
+					markChunkDecorated(command.chunk);
+					completeChunkStage(command.chunk, ChunkStage::Decorated);
+				}
+				break;
+				case CommandType::CalculateLighting:
+				{
+					robin_hood::unordered_flat_map<Chunk*, uint16> chunksToRetesselate = {};
+					if (command.chunk->hasCachedLight)
+					{
+						ChunkPrivate::spreadCachedLight(command.chunk, chunksToRetesselate);
+						command.chunk->hasCachedLight = false;
+					}
+					else
+					{
+						ChunkPrivate::calculateLighting(command.chunk, chunksToRetesselate, snapshot);
+					}
+
+					// Neighbors that were meshed before this chunk existed have holes along this border
+					chunksToRetesselate[command.chunk->topNeighbor] |= AllChunkLevels;
+					chunksToRetesselate[command.chunk->bottomNeighbor] |= AllChunkLevels;
+					chunksToRetesselate[command.chunk->leftNeighbor] |= AllChunkLevels;
+					chunksToRetesselate[command.chunk->rightNeighbor] |= AllChunkLevels;
+					completeChunkStage(command.chunk, ChunkStage::Lit);
+
+					for (const auto& pair : chunksToRetesselate)
+					{
+						// Chunks that haven't been meshed yet will pick up the new light when they are
+						Chunk* chunk = pair.first;
+						if (chunk && chunk != command.chunk && chunk->stage == ChunkStage::Meshed)
+						{
+							queueRetesselateLevels(chunk, pair.second);
+						}
+					}
+				}
+				break;
+				case CommandType::RecalculateLighting:
+				{
+					robin_hood::unordered_flat_map<Chunk*, uint16> chunksToRetesselate = {};
+					ChunkPrivate::calculateLightingUpdate(command.chunk, command.chunk->chunkCoords, command.blockThatUpdated, command.removedLightSource, chunksToRetesselate);
+					for (const auto& pair : chunksToRetesselate)
+					{
+						// Only the levels the light actually changed in have to be meshed again
+						Chunk* chunk = pair.first;
+						if (chunk && chunk->stage == ChunkStage::Meshed)
+						{
+							queueRetesselateLevels(chunk, pair.second);
+						}
+					}
+				}
+				break;
+				case CommandType::TesselateVertices:
+				{
+					// The queued bit was cleared before this ran, so any level added from here on queues another mesh
+					uint16 levels = command.chunk->levelsToMesh.exchange(0);
+					if (command.chunk->stage == ChunkStage::Lit)
+					{
+						// This is the mesh that makes the chunk Meshed, so it has to cover every level even if
+						// the levels it picked up came from an edit queued before the first full mesh ran
+						levels |= AllChunkLevels;
+					}
+					if (levels)
+					{
+						uint32 meshVersion = ++command.chunk->meshVersion;
+						ChunkPrivate::generateRenderData(command.subChunks, command.chunk, command.chunk->chunkCoords, meshVersion, levels, snapshot, meshScratch);
+					}
+					if (command.chunk->stage == ChunkStage::Lit)
+					{
+						completeChunkStage(command.chunk, ChunkStage::Meshed);
+					}
+				}
+				break;
+				case CommandType::LoadBlockData:
+				case CommandType::SaveBlockData:
+					g_logger_assert(false, "Disk commands only run on the I/O thread.");
+				break;
+				}
+			}
+
+			WorkerQueue* queues;
+			uint32 numThreads;
+			std::atomic<uint32> nextQueue = 0;
+			std::atomic<int32> numQueuedCommands;
+			std::atomic<int32> numPendingCommands;
+			// How long each kind of command has taken, reported after pregenerating a world
+			std::array<CommandStats, NumCommandTypes> commandStats;
+
+			std::vector<std::thread> workerThreads;
+			std::thread ioThread;
+			std::deque<FillChunkCommand> ioCommands;
+			std::condition_variable ioCv;
+			std::mutex ioMtx;
+			std::atomic<glm::ivec2> playerPosChunkCoords;
+			std::atomic<uint32> priorityEpoch;
+			std::mutex cameraMtx;
+			Frustum cameraFrustum;
+			bool hasCameraFrustum;
+			// Only touched by setCameraFrustum, which is called from the main thread
+			std::chrono::steady_clock::time_point lastFrustumRank;
+			std::condition_variable cv;
+			std::mutex mtx;
+			// One per chunk position, see NeighborhoodLock
+			std::shared_mutex chunkLocks[ChunkLockStride * ChunkLockStride];
+			std::atomic<bool> doWork;
+		};
+
+		struct DrawCommand
+		{
+			DrawArraysIndirectCommand command;
+			int distanceToPlayer;
+			int level;
+		};
+
+		namespace DrawCommandUtil
+		{
+			bool operator<(const DrawCommand& a, const DrawCommand& b)
+			{
+				return a.distanceToPlayer < b.distanceToPlayer;
+			}
+
+			static bool operator>(const DrawCommand& a, const DrawCommand& b)
+			{
+				return a.distanceToPlayer > b.distanceToPlayer;
+			}
+		}
+
+		class CommandBufferContainer
+		{
+		public:
+			CommandBufferContainer(int maxNumCommands, bool isTransparent)
+			{
+				this->maxNumCommands = maxNumCommands;
+				this->isTransparent = isTransparent;
+				commandBuffer = nullptr;
+				chunkPosBuffer = nullptr;
+				biomeBuffer = nullptr;
+				numCommands = 0;
+			}
+
+			void init()
+			{
+				this->commandBuffer = (DrawCommand*)g_memory_allocate(sizeof(DrawCommand) * maxNumCommands);
+				this->chunkPosBuffer = (int32*)g_memory_allocate(sizeof(int32) * maxNumCommands * 2);
+				this->biomeBuffer = (int32*)g_memory_allocate(sizeof(int32) * maxNumCommands);
+				this->numCommands = 0;
+			}
+
+			void free()
+			{
+				if (commandBuffer)
+				{
+					g_memory_free(commandBuffer);
+					commandBuffer = nullptr;
+				}
+
+				if (chunkPosBuffer)
+				{
+					g_memory_free(chunkPosBuffer);
+					chunkPosBuffer = nullptr;
+				}
+
+				if (biomeBuffer)
+				{
+					g_memory_free(biomeBuffer);
+					biomeBuffer = nullptr;
+				}
+			}
+
+			void add(const DrawArraysIndirectCommand& command, const glm::ivec2& chunkCoords, int level, const glm::ivec2& playerPosChunkCoords, int biome)
+			{
+				g_logger_assert((numCommands + 1) < maxNumCommands, "Ran out of room in command buffer!");
+				glm::ivec2 d = chunkCoords - playerPosChunkCoords;
+				int dSquared = (d.x * d.x) + (d.y * d.y);
+				commandBuffer[numCommands] = { command, dSquared, level };
+				commandBuffer[numCommands].command.baseInstance = numCommands;
+				chunkPosBuffer[(numCommands * 2)] = chunkCoords.x;
 				chunkPosBuffer[(numCommands * 2) + 1] = chunkCoords.y;
 				biomeBuffer[numCommands] = biome;
 				numCommands++;
@@ -404,12 +1056,38 @@ namespace Minecraft
 
 		// Internal functions
 		static void retesselateChunkBlockUpdate(const glm::ivec2& chunkCoords, const glm::vec3& worldPosition, Chunk* blockData);
+		static Chunk* addChunk(const glm::ivec2& chunkCoordinates, ChunkState state, ChunkData* cachedData = nullptr, uint32 cachedSequence = 0);
+		static void dropCachedNeighbors(const glm::ivec2& chunkCoords);
+		static void queueNextChunkStage(Chunk* chunk);
+		static void freeSubChunk(uint32 subChunkIndex);
+		static bool neighborsReachedStage(const Chunk* chunk, ChunkStage stage);
+		static bool isInLoadArea(const glm::ivec2& chunkCoords, const glm::ivec2& playerPosChunkCoords);
+		static bool unloadOutOfRangeChunks(const glm::ivec2& playerPosChunkCoords);
+		static bool isNeighborhoodPinned(const Chunk* chunk);
+		static ChunkData* newChunkData();
+		static void freeChunkData(ChunkData* chunkData);
+		static void loadChunksInRange(const glm::ivec2& playerPosChunkCoords);
 
 		// Internal variables
+		// Guards chunk stages and the neighbor pointers between chunks. The directory has its own locks
 		static std::mutex chunkMtx;
 		static uint32 processorCount = 0;
-		static robin_hood::unordered_node_map<glm::ivec2, Chunk> chunks = {};
-		static std::list<Block*> chunkFreeList = {};
+		// Headless mode never meshes or renders, so it has no GL context and chunks stop once they're lit
+		static bool isHeadless = false;
+		// While pregenerating, chunks outside this circle are never loaded. A negative radius means no limit
+		static glm::ivec2 pregenCenter = glm::ivec2(0, 0);
+		static int pregenRadius = -1;
+		static ChunkDirectory chunks;
+		// Data of chunks that left the radius but can still be handed right back. Evicted data goes on the free list
+		static ChunkCache chunkCache;
+		// Everything below is sized for this many chunks around the player, so changing it means starting over
+		static int chunkRadius = 0;
+		static uint32 chunkCapacity = 0;
+		// Where chunks were last loaded around, so they can be loaded again after the radius changes
+		static glm::vec3 lastCheckedPlayerPosition = glm::vec3(0.0f);
+		static bool hasCheckedPlayerPosition = false;
+		// So running into the block data budget is only logged once each time it happens
+		static bool isOverBlockBudget = false;
 
 		static uint32 chunkPosInstancedBuffer;
 		static uint32 biomeInstancedVbo;
@@ -419,36 +1097,85 @@ namespace Minecraft
 		static uint32 solidDrawCommandVbo;
 		static uint32 blendableDrawCommandVbo;
 		static Shader compositeShader;
+		// Hands out ranges of the persistently mapped globalRenderVbo, in vertices. Workers allocate and the main thread frees
+		static TlsfAllocator vertexAllocator;
+		static std::mutex vertexAllocatorMtx;
+		static Vertex* vertexBasePointer = nullptr;
 
 		static ChunkWorker* chunkWorker = nullptr;
-		static Pool<SubChunk, World::ChunkCapacity * 16>* subChunks = nullptr;
-		static Pool<Block, World::ChunkCapacity>* blockPool = nullptr;
+		// Workers push sub-chunk changes here and the main thread applies them, so it never has to scan the whole pool
+		static MpscQueue<SubChunkEvent>* subChunkEvents = nullptr;
+		// Bumped every time the chunk in a block pool slot is queued for saving or replaced
+		static std::atomic<uint32>* chunkGenerations = nullptr;
+		// Bumped every time a chunk generates its decorations. Guarded by the chunk mutex
+		static uint32 decorationSequence = 0;
+		static Pool<SubChunk>* subChunks = nullptr;
+		// Page backed, so slots that were never used or have been freed don't take up any memory.
+		// The pool's free stack is the free list for block data
+		static Pool<ChunkData>* blockPool = nullptr;
 		static CommandBufferContainer* solidCommandBuffer = nullptr;
 		static CommandBufferContainer* blendableCommandBuffer = nullptr;
 
-		void init()
+		void init(bool headless)
 		{
-			// A chunk uses 55,000 vertices on average, so a sub-chunk can be estimated to use about 
-			// 4,500 vertices on average. That's the default vertex bucket size
-			processorCount = 1;// std::thread::hardware_concurrency();
+			isHeadless = headless;
+
+			processorCount = Settings::Chunks::numWorkerThreads;
+			if (processorCount == 0)
+			{
+				// Leave one core free for the main thread, unless there's nothing to render
+				uint32 hardwareThreads = std::thread::hardware_concurrency();
+				if (isHeadless)
+				{
+					processorCount = hardwareThreads > 0 ? hardwareThreads : 1;
+				}
+				else
+				{
+					processorCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+				}
+			}
+			g_logger_info("Starting %d chunk worker threads.", processorCount);
+
+			// The load area is a circle, so a square around it leaves room for chunks that are still saving
+			chunkRadius = glm::clamp((int)Settings::Chunks::chunkRadius, (int)World::MinChunkRadius, (int)World::MaxChunkRadius);
+			chunkCapacity = (uint32)((chunkRadius * 2) * (chunkRadius * 2));
+			g_logger_info("Render distance is %d chunks, room for %u chunks.", chunkRadius, chunkCapacity);
 
 			// Initialize the singletons
-			chunkWorker = new ChunkWorker();
-			subChunks = new Pool<SubChunk, World::ChunkCapacity * 16>(1);
-			blockPool = new Pool<Block, World::ChunkCapacity>(World::ChunkDepth * World::ChunkWidth * World::ChunkHeight);
+			chunkWorker = new ChunkWorker(processorCount);
+			subChunks = new Pool<SubChunk>(1, chunkCapacity * 16);
+			// Every sub-chunk can have an upload waiting, and there's a finished mesh per chunk on top of that.
+			// Twice the pool leaves plenty of slack, so the workers practically never wait on the main thread
+			uint32 subChunkEventCapacity = 1;
+			while (subChunkEventCapacity < chunkCapacity * 16 * 2)
+			{
+				subChunkEventCapacity <<= 1;
+			}
+			subChunkEvents = new MpscQueue<SubChunkEvent>(subChunkEventCapacity);
+			blockPool = new Pool<ChunkData>(1, chunkCapacity, true);
+			chunkGenerations = new std::atomic<uint32>[chunkCapacity];
+			for (uint32 i = 0; i < chunkCapacity; i++)
+			{
+				chunkGenerations[i].store(0, std::memory_order_relaxed);
+			}
+			MemoryTracker::setBudget(MemoryTag::ChunkBlocks, (size_t)Settings::Memory::chunkBlockBudgetMegabytes * 1024 * 1024);
+			MemoryTracker::setBudget(MemoryTag::SubChunkVertices, (size_t)Settings::Memory::subChunkVertexBudgetMegabytes * 1024 * 1024);
+			isOverBlockBudget = false;
 			solidCommandBuffer = new CommandBufferContainer(subChunks->size(), false);
 			blendableCommandBuffer = new CommandBufferContainer(subChunks->size(), true);
 
-			compositeShader.compile("assets/shaders/CompositeShader.glsl");
-
-			// Initialize the free list
 			chunks.clear();
-			chunkFreeList.clear();
-			for (int i = 0; i < (int)blockPool->size(); i++)
+			chunkCache.setMemoryBudget((size_t)Settings::Chunks::chunkCacheMegabytes * 1024 * 1024);
+
+			if (isHeadless)
 			{
-				chunkFreeList.push_back((*blockPool)[i]);
+				g_logger_info("Block Pool Total Size: %2.3f Gb", (float)(blockPool->totalSize() / (1024.0f * 1024 * 1024)));
+				DebugStats::totalChunkRamAvailable = (float)blockPool->totalSize();
+				return;
 			}
 
+			compositeShader.compile("assets/shaders/CompositeShader.glsl");
+
 			// Set up draw commands to relate to our sub chunks
 			solidCommandBuffer->init();
 			glCreateBuffers(1, &solidDrawCommandVbo);
@@ -465,10 +1192,48 @@ namespace Minecraft
 			glCreateVertexArrays(1, &globalVao);
 			glBindVertexArray(globalVao);
 
-			glGenBuffers(1, &globalRenderVbo);
-			glBindBuffer(GL_ARRAY_BUFFER, globalRenderVbo);
+			// Sub-chunks take as much of this as they need, so dense ones don't have to spill over into
+			// more draw commands and sparse ones don't leave most of a fixed size slot empty
+			uint32 totalSubChunkVertices = subChunks->size() * World::AverageVertsPerSubChunk;
+			size_t vertexBudget = (size_t)Settings::Memory::subChunkVertexBudgetMegabytes * 1024 * 1024;
+			if (vertexBudget != 0 && (size_t)totalSubChunkVertices * sizeof(Vertex) > vertexBudget)
+			{
+				// Anything past the budget could never be handed out anyways
+				totalSubChunkVertices = (uint32)(vertexBudget / sizeof(Vertex));
+			}
+
+			// Set up our global immutable buffer. Big render distances ask for a lot of memory up front, so
+			// if the driver can't map that much keep halving it. Sub-chunks that don't fit wait for room
+			// like they do when they go over the budget
+			GLbitfield flags = GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT | GL_MAP_COHERENT_BIT;
+			size_t totalSizeOfSubChunkVertices = 0;
+			vertexBasePointer = nullptr;
+			while (totalSubChunkVertices >= World::AverageVertsPerSubChunk)
+			{
+				totalSizeOfSubChunkVertices = (size_t)totalSubChunkVertices * sizeof(Vertex);
+				glGenBuffers(1, &globalRenderVbo);
+				glBindBuffer(GL_ARRAY_BUFFER, globalRenderVbo);
+				glBufferStorage(GL_ARRAY_BUFFER, totalSizeOfSubChunkVertices, NULL, flags);
+				vertexBasePointer = (Vertex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSizeOfSubChunkVertices, flags);
+				if (vertexBasePointer)
+				{
+					break;
+				}
+
+				g_logger_warning("Could not map %2.3f Gb for sub-chunk vertices, trying half that.", (float)(totalSizeOfSubChunkVertices / (1024.0f * 1024 * 1024)));
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				glDeleteBuffers(1, &globalRenderVbo);
+				globalRenderVbo = 0;
+				totalSubChunkVertices /= 2;
+			}
 
-			size_t totalSizeOfSubChunkVertices = subChunks->size() * World::MaxVertsPerSubChunk * sizeof(Vertex);
+			if (!vertexBasePointer)
+			{
+				// Nothing can be meshed, but the world still loads
+				g_logger_error("Could not map any memory for sub-chunk vertices, chunks will not be rendered.");
+				totalSubChunkVertices = 0;
+				totalSizeOfSubChunkVertices = 0;
+			}
 
 			// Set our vertex attribute pointers
 			glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(Vertex), (void*)offsetof(Vertex, data1));
@@ -479,17 +1244,14 @@ namespace Minecraft
 			glVertexAttribDivisor(1, 0);
 			glEnableVertexAttribArray(1);
 
-			// Set up our global immutable buffer
-			GLbitfield flags = GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT | GL_MAP_COHERENT_BIT;
-			glBufferStorage(GL_ARRAY_BUFFER, totalSizeOfSubChunkVertices, NULL, flags);
-			Vertex* basePointer = (Vertex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, subChunks->size() * World::MaxVertsPerSubChunk, flags);
+			vertexAllocator.init(totalSubChunkVertices);
 			for (uint32 i = 0; i < subChunks->size(); i++)
 			{
-				// Assign the pointers for the data on the CPU
-				(*subChunks)[i]->first = (i * World::MaxVertsPerSubChunk);
-				(*subChunks)[i]->data = basePointer + (*subChunks)[i]->first;
+				(*subChunks)[i]->first = 0;
+				(*subChunks)[i]->vertexAllocation = TlsfAllocator::InvalidHandle;
 				(*subChunks)[i]->numVertsUsed = 0;
 				(*subChunks)[i]->drawCommandIndex = i;
+				(*subChunks)[i]->meshVersion = 0;
 				(*subChunks)[i]->state = SubChunkState::Unloaded;
 			}
 
@@ -520,20 +1282,7 @@ namespace Minecraft
 
 		void free()
 		{
-			// Delete GPU memory
-			// TODO: Do error checking on these VBOs to ensure they are valid
-			glDeleteBuffers(1, &solidDrawCommandVbo);
-			glDeleteBuffers(1, &blendableDrawCommandVbo);
-
-			chunks.clear();
-			chunkFreeList.clear();
-
-			glDeleteBuffers(1, &globalRenderVbo);
-			glDeleteBuffers(1, &chunkPosInstancedBuffer);
-			glDeleteBuffers(1, &biomeInstancedVbo);
-			glDeleteVertexArrays(1, &globalVao);
-
-			// Delete CPU memory
+			// The workers write into the mapped vertex buffer, so they have to stop before it goes away
 			if (chunkWorker)
 			{
 				chunkWorker->free();
@@ -541,18 +1290,69 @@ namespace Minecraft
 				chunkWorker = nullptr;
 			}
 
+			// Delete GPU memory
+			// TODO: Do error checking on these VBOs to ensure they are valid
+			if (!isHeadless)
+			{
+				glDeleteBuffers(1, &solidDrawCommandVbo);
+				glDeleteBuffers(1, &blendableDrawCommandVbo);
+
+				glDeleteBuffers(1, &globalRenderVbo);
+				vertexBasePointer = nullptr;
+				// Every sub-chunk goes away with the buffer, they aren't freed one by one
+				MemoryTracker::remove(MemoryTag::SubChunkVertices, (size_t)vertexAllocator.used() * sizeof(Vertex));
+				vertexAllocator.init(0);
+				glDeleteBuffers(1, &chunkPosInstancedBuffer);
+				glDeleteBuffers(1, &biomeInstancedVbo);
+				glDeleteVertexArrays(1, &globalVao);
+			}
+
+			// Delete CPU memory
+
+			// The worker has to finish saving before the chunks it's saving go away
+			{
+				// Only block data that's in use was ever constructed, the block pool below owns the memory
+				std::vector<ChunkData*> usedData;
+				chunks.forEach([&](Chunk& chunk)
+				{
+					if (chunk.data)
+					{
+						usedData.push_back(chunk.data);
+					}
+				});
+				chunkCache.clear(usedData);
+				for (ChunkData* chunkData : usedData)
+				{
+					chunkData->~ChunkData();
+					MemoryTracker::remove(MemoryTag::ChunkBlocks, sizeof(ChunkData));
+				}
+			}
+			chunks.clear();
+
 			if (subChunks)
 			{
 				delete subChunks;
 				subChunks = nullptr;
 			}
 
+			if (subChunkEvents)
+			{
+				delete subChunkEvents;
+				subChunkEvents = nullptr;
+			}
+
 			if (blockPool)
 			{
 				delete blockPool;
 				blockPool = nullptr;
 			}
 
+			delete[] chunkGenerations;
+			chunkGenerations = nullptr;
+			chunkRadius = 0;
+			chunkCapacity = 0;
+			hasCheckedPlayerPosition = false;
+
 			if (solidCommandBuffer)
 			{
 				solidCommandBuffer->free();
@@ -567,23 +1367,31 @@ namespace Minecraft
 				blendableCommandBuffer = nullptr;
 			}
 
-			compositeShader.destroy();
+			if (!isHeadless)
+			{
+				compositeShader.destroy();
+			}
+			pregenRadius = -1;
 		}
 
 		void serialize()
 		{
-			for (robin_hood::pair<const glm::ivec2, Chunk>& chunkIter : chunks)
+			std::vector<glm::ivec2> chunksToSave;
+			chunks.forEach([&](Chunk& chunk)
 			{
-				Chunk& chunk = chunkIter.second;
-				Block* blockData = chunk.data;
-				if (chunk.state != ChunkState::Saving && blockData)
+				if (chunk.state != ChunkState::Saving && chunk.data)
 				{
-					queueSaveChunk(chunkIter.first);
+					chunksToSave.push_back(chunk.chunkCoords);
 				}
+			});
+
+			for (const glm::ivec2& chunkCoords : chunksToSave)
+			{
+				queueSaveChunk(chunkCoords);
 			}
 		}
 
-		robin_hood::unordered_node_map<glm::ivec2, Chunk>& getAllChunks()
+		ChunkDirectory& getAllChunks()
 		{
 			return chunks;
 		}
@@ -594,58 +1402,27 @@ namespace Minecraft
 			Chunk* chunk = getChunk(chunkCoordinates);
 			if (!chunk)
 			{
-				if (chunkFreeList.size() > 0)
+				uint32 cachedSequence = 0;
+				ChunkData* cachedData = chunkCache.take(chunkCoordinates, &cachedSequence);
+				chunk = addChunk(chunkCoordinates, ChunkState::Loaded, cachedData, cachedSequence);
+				if (chunk && cachedData)
 				{
-					Chunk newChunk;
-					newChunk.data = chunkFreeList.front();
-					chunkFreeList.pop_front();
-
-					newChunk.chunkCoords = chunkCoordinates;
-					newChunk.topNeighbor = getChunk(chunkCoordinates + INormals2::Up);
-					newChunk.bottomNeighbor = getChunk(chunkCoordinates + INormals2::Down);
-					newChunk.leftNeighbor = getChunk(chunkCoordinates + INormals2::Left);
-					newChunk.rightNeighbor = getChunk(chunkCoordinates + INormals2::Right);
-					newChunk.state = ChunkState::Loaded;
-
-					{
-						// TODO: Ensure this is only ever accessed from the main thread
-						//std::lock_guard lock(chunkMtx);
-						chunks[newChunk.chunkCoords] = newChunk;
-					}
-
+					// Already decorated, and usually lit so it only needs its light spread into any new neighbors
+					completeChunkStage(chunk, ChunkStage::Decorated);
+				}
+				else if (chunk)
+				{
+					// Queue the load command, the rest of the stages get queued as the neighborhood catches up
 					FillChunkCommand cmd;
-					cmd.type = CommandType::GenerateTerrain;
-					cmd.chunk = &chunks[newChunk.chunkCoords];
+					cmd.type = CommandType::LoadBlockData;
+					cmd.chunk = chunk;
 					cmd.subChunks = subChunks;
-
-					// Queue the fill command
-					chunkWorker->queueCommand(cmd);
-					// Queue the calculate lighting command
-					cmd.type = CommandType::CalculateLighting;
-					chunkWorker->queueCommand(cmd);
-					// Queue the tesselate command
-					cmd.type = CommandType::TesselateVertices;
 					chunkWorker->queueCommand(cmd);
-
-					DebugStats::totalChunkRamUsed = DebugStats::totalChunkRamUsed + blockPool->poolSize() * sizeof(Block);
-				}
-				else
-				{
-					// What do we do if there were no free blocks?
-					g_logger_warning("No free pools for block data.");
 				}
 			}
 		}
 
-		void queueCalculateLighting(const glm::ivec2& lastPlayerPosInChunkCoords)
-		{
-			FillChunkCommand cmd;
-			cmd.type = CommandType::CalculateLighting;
-			cmd.playerPosChunkCoords = lastPlayerPosInChunkCoords;
-			chunkWorker->queueCommand(cmd);
-		}
-
-		void queueRecalculateLighting(const glm::ivec2& chunkCoordinates, const glm::vec3& blockPositionThatUpdated, bool removedLightSource)
+		void queueRecalculateLighting(const glm::ivec2& chunkCoordinates, const glm::vec3& blockPositionThatUpdated, bool removedLightSource)
 		{
 			// Only recalculate if we need to
 			Chunk* chunk = getChunk(chunkCoordinates);
@@ -658,9 +1435,8 @@ namespace Minecraft
 				cmd.blockThatUpdated = blockPositionThatUpdated;
 				cmd.removedLightSource = removedLightSource;
 
+				// The edit already re-meshed the levels around the block, and the command meshes wherever the light changes
 				chunkWorker->queueCommand(cmd);
-				// TODO: this probably isn't necessary, find all the unneccessary retesselations and remove them
-				queueRetesselateChunk(chunkCoordinates, chunk);
 			}
 		}
 
@@ -671,39 +1447,32 @@ namespace Minecraft
 				chunk = getChunk(chunkCoordinates);
 			}
 
-			if (chunk)
+			// Chunks that haven't been meshed yet will be once their neighborhood is lit
+			if (chunk && chunk->stage == ChunkStage::Meshed)
 			{
-				FillChunkCommand cmd;
-				cmd.type = CommandType::TesselateVertices;
-				cmd.subChunks = subChunks;
-				cmd.chunk = chunk;
-
-				// Update the sub-chunks that are about to be deleted
-				for (int i = 0; i < (int)subChunks->size(); i++)
-				{
-					if ((*subChunks)[i]->chunkCoordinates == chunkCoordinates && (*subChunks)[i]->state == SubChunkState::Uploaded)
-					{
-						(*subChunks)[i]->state = SubChunkState::RetesselateVertices;
-					}
-				}
-
 				// TODO: Remove this flag, this is mostly for debugging
 				if (!doImmediately)
 				{
-					chunkWorker->queueCommand(cmd);
+					queueRetesselateLevels(chunk, AllChunkLevels);
 					chunkWorker->beginWork();
 				}
 				else
 				{
-					ChunkPrivate::generateRenderData(subChunks, chunk, chunk->chunkCoords);
+					// Only used for debugging, so the main thread doesn't keep scratch space around for it
+					ChunkSnapshot* snapshot = new ChunkSnapshot();
+					MeshScratch* meshScratch = new MeshScratch();
+					uint32 meshVersion = ++chunk->meshVersion;
+					ChunkPrivate::generateRenderData(subChunks, chunk, chunk->chunkCoords, meshVersion, AllChunkLevels, *snapshot, *meshScratch);
+					delete snapshot;
+					delete meshScratch;
 				}
 			}
 		}
 
 		void queueSaveChunk(const glm::ivec2& chunkCoordinates)
 		{
-			// TODO: This could be bad... Maybe we should return a copy of the ChunkStateData instead of a pointer
-			// because it's very possible that the pointer could become invalid 
+			// Only the main thread erases chunks, and never while they're pinned by a command, so this
+			// pointer stays valid for as long as the save command holds it
 
 			// Only save if we need to
 			Chunk* chunk = getChunk(chunkCoordinates);
@@ -712,6 +1481,15 @@ namespace Minecraft
 				if (chunk->state != ChunkState::Saving && chunk->data)
 				{
 					chunk->state = ChunkState::Saving;
+					// Cancel anything still queued for this chunk, the save below gets the new generation
+					chunkGenerations[getChunkSlot(chunk)]++;
+
+					// The chunk won't be drawn anymore
+					for (uint32 subChunkIndex : chunk->subChunkIndices)
+					{
+						freeSubChunk(subChunkIndex);
+					}
+					chunk->subChunkIndices.clear();
 					FillChunkCommand cmd;
 					cmd.type = CommandType::SaveBlockData;
 					cmd.chunk = chunk;
@@ -727,56 +1505,29 @@ namespace Minecraft
 			Chunk* chunk = getChunk(chunkCoordinates);
 			if (!chunk)
 			{
-				if (chunkFreeList.size() > 0)
+				// The server's copy wins over anything we kept around
+				ChunkData* cachedData = chunkCache.take(chunkCoordinates);
+				if (cachedData)
 				{
-					Chunk newChunk;
-					newChunk.data = chunkFreeList.front();
-					chunkFreeList.pop_front();
-
-					newChunk.chunkCoords = chunkCoordinates;
-					newChunk.topNeighbor = getChunk(chunkCoordinates + INormals2::Up);
-					newChunk.bottomNeighbor = getChunk(chunkCoordinates + INormals2::Down);
-					newChunk.leftNeighbor = getChunk(chunkCoordinates + INormals2::Left);
-					newChunk.rightNeighbor = getChunk(chunkCoordinates + INormals2::Right);
-					newChunk.state = state;
-
-					{
-						// TODO: Ensure this is only ever accessed from the main thread
-						//std::lock_guard lock(chunkMtx);
-						chunks[newChunk.chunkCoords] = newChunk;
-					}
+					freeChunkData(cachedData);
+				}
 
+				chunk = addChunk(chunkCoordinates, state);
+				if (chunk)
+				{
+					// Queue the fill command, the rest of the stages get queued as the neighborhood catches up
 					FillChunkCommand cmd;
 					cmd.type = CommandType::ClientLoadChunk;
-					cmd.chunk = &chunks[newChunk.chunkCoords];
+					cmd.chunk = chunk;
 					cmd.subChunks = subChunks;
 					cmd.clientChunkData = chunkData;
-
-					// Queue the fill command
-					chunkWorker->queueCommand(cmd);
-					// Queue the calculate lighting command
-					cmd.type = CommandType::CalculateLighting;
 					chunkWorker->queueCommand(cmd);
-					// Queue the tesselate command
-					cmd.type = CommandType::TesselateVertices;
-					chunkWorker->queueCommand(cmd);
-
-					DebugStats::totalChunkRamUsed = DebugStats::totalChunkRamUsed + blockPool->poolSize() * sizeof(Block);
-				}
-				else
-				{
-					// What do we do if there were no free blocks?
-					g_logger_warning("No free pools for block data.");
+					return;
 				}
 			}
-		}
 
-		void queueGenerateDecorations(const glm::ivec2& lastPlayerLoadChunkPos)
-		{
-			FillChunkCommand cmd;
-			cmd.type = CommandType::GenerateDecorations;
-			cmd.playerPosChunkCoords = lastPlayerLoadChunkPos;
-			chunkWorker->queueCommand(cmd);
+			// Nothing took the block data
+			MemoryTracker::free(MemoryTag::Network, chunkData);
 		}
 
 		Block getBlock(const glm::vec3& worldPosition)
@@ -809,8 +1560,16 @@ namespace Minecraft
 				return;
 			}
 
-			if (ChunkPrivate::setBlock(worldPosition, chunkCoords, chunk, newBlock))
+			bool blockChanged = false;
+			{
+				// The edit only writes this chunk. Light and meshes are redone by the commands queued below
+				ChunkWorker::NeighborhoodLock chunkLock = chunkWorker->lockChunks(chunkCoords, 0);
+				blockChanged = ChunkPrivate::setBlock(worldPosition, chunkCoords, chunk, newBlock);
+			}
+
+			if (blockChanged)
 			{
+				dropCachedNeighbors(chunkCoords);
 				retesselateChunkBlockUpdate(chunkCoords, worldPosition, chunk);
 				queueRecalculateLighting(chunkCoords, worldPosition, false);
 				chunkWorker->beginWork();
@@ -833,8 +1592,15 @@ namespace Minecraft
 			}
 
 			bool isLightSourceBlock = ChunkManager::getBlock(worldPosition).isLightSource();
-			if (ChunkPrivate::removeBlock(worldPosition, chunkCoords, chunk))
+			bool blockChanged = false;
 			{
+				ChunkWorker::NeighborhoodLock chunkLock = chunkWorker->lockChunks(chunkCoords, 0);
+				blockChanged = ChunkPrivate::removeBlock(worldPosition, chunkCoords, chunk);
+			}
+
+			if (blockChanged)
+			{
+				dropCachedNeighbors(chunkCoords);
 				retesselateChunkBlockUpdate(chunkCoords, worldPosition, chunk);
 				queueRecalculateLighting(chunkCoords, worldPosition, isLightSourceBlock);
 				chunkWorker->beginWork();
@@ -849,31 +1615,25 @@ namespace Minecraft
 
 		Chunk* getChunk(const glm::ivec2& chunkCoords)
 		{
-			Chunk* chunk = nullptr;
-
-			{
-				// TODO: Make this thread-safe somehow or something
-				// or make sure no threads access this
-				//std::lock_guard<std::mutex> lock(chunkMtx);
-				const robin_hood::unordered_map<glm::ivec2, Chunk>::iterator& iter = chunks.find(chunkCoords);
-				if (iter != chunks.end())
-				{
-					chunk = &iter->second;
-				}
-			}
-
-			return chunk;
+			return chunks.find(chunkCoords);
 		}
 
 		void patchChunkPointers()
 		{
-			for (auto& pair : chunks)
+			std::vector<Chunk*> allChunks;
+			allChunks.reserve(chunks.size());
+			chunks.forEach([&](Chunk& chunk)
 			{
-				Chunk& chunk = pair.second;
-				chunk.topNeighbor = getChunk(chunk.chunkCoords + INormals2::Up);
-				chunk.bottomNeighbor = getChunk(chunk.chunkCoords + INormals2::Down);
-				chunk.leftNeighbor = getChunk(chunk.chunkCoords + INormals2::Left);
-				chunk.rightNeighbor = getChunk(chunk.chunkCoords + INormals2::Right);
+				allChunks.push_back(&chunk);
+			});
+
+			std::lock_guard<std::mutex> lock(chunkMtx);
+			for (Chunk* chunk : allChunks)
+			{
+				chunk->topNeighbor = getChunk(chunk->chunkCoords + INormals2::Up);
+				chunk->bottomNeighbor = getChunk(chunk->chunkCoords + INormals2::Down);
+				chunk->leftNeighbor = getChunk(chunk->chunkCoords + INormals2::Left);
+				chunk->rightNeighbor = getChunk(chunk->chunkCoords + INormals2::Right);
 			}
 		}
 
@@ -884,63 +1644,41 @@ namespace Minecraft
 
 		void render(const glm::vec3& playerPosition, const glm::ivec2& playerPositionInChunkCoords, Shader& opaqueShader, Shader& transparentShader, const Frustum& cameraFrustum)
 		{
-			chunkWorker->setPlayerPosChunkCoords(playerPositionInChunkCoords);
+			chunkWorker->setCameraFrustum(playerPositionInChunkCoords, cameraFrustum);
+
+			processSubChunkEvents();
 
-			for (int i = 0; i < (int)subChunks->size(); i++)
+			chunks.forEach([&](const Chunk& chunk)
 			{
-				if ((*subChunks)[i]->state != SubChunkState::Unloaded)
+				if (chunk.state != ChunkState::Loaded)
 				{
-					glm::ivec2 chunkPos = (*subChunks)[i]->chunkCoordinates;
-					const auto& iter = chunks.find(chunkPos);
-					if (iter == chunks.end() && (*subChunks)[i]->state != SubChunkState::TesselatingVertices)
-					{
-						// If the chunk coords are no longer loaded, set this chunk as not in use anymore
-						(*subChunks)[i]->state = SubChunkState::Unloaded;
-						(*subChunks)[i]->numVertsUsed = 0;
-						subChunks->freePool(i);
-					}
-					else if (iter != chunks.end() && iter->second.state == ChunkState::Loaded)
+					return;
+				}
+
+				for (uint32 subChunkIndex : chunk.subChunkIndices)
+				{
+					const SubChunk* subChunk = (*subChunks)[subChunkIndex];
+					float yCenter = (float)subChunk->subChunkLevel * 16.0f;
+					glm::vec3 chunkPos = glm::vec3(subChunk->chunkCoordinates.x * World::ChunkDepth, yCenter, subChunk->chunkCoordinates.y * World::ChunkWidth);
+					if (cameraFrustum.isBoxVisible(chunkPos, chunkPos + glm::vec3(16, 16, 16)))
 					{
-						if ((*subChunks)[i]->state == SubChunkState::UploadVerticesToGpu)
+						DrawArraysIndirectCommand drawCommand;
+						g_logger_assert(subChunk->numVertsUsed.load() > 0, "Sub Chunk should never have tried to upload 0 verts to GPU.");
+						drawCommand.baseInstance = 0;
+						drawCommand.instanceCount = 1;
+						drawCommand.count = subChunk->numVertsUsed;
+						drawCommand.first = subChunk->first;
+						if (subChunk->isBlendable)
 						{
-							g_logger_assert((*subChunks)[i]->numVertsUsed.load() > 0, "Sub Chunk should never have tried to upload 0 verts to GPU.");
-							(*subChunks)[i]->state = SubChunkState::Uploaded;
+							blendableCommandBuffer->add(drawCommand, subChunk->chunkCoordinates, subChunk->subChunkLevel, playerPositionInChunkCoords, 0);
 						}
-
-						if ((*subChunks)[i]->state == SubChunkState::Uploaded || (*subChunks)[i]->state == SubChunkState::RetesselateVertices ||
-							(*subChunks)[i]->state == SubChunkState::DoneRetesselating)
+						else
 						{
-							g_logger_assert((*subChunks)[i]->numVertsUsed.load() > 0, "Sub Chunk should never have tried to upload 0 verts to GPU.");
-							float yCenter = (float)(*subChunks)[i]->subChunkLevel * 16.0f;
-							glm::vec3 chunkPos = glm::vec3((*subChunks)[i]->chunkCoordinates.x * World::ChunkDepth, yCenter, (*subChunks)[i]->chunkCoordinates.y * World::ChunkWidth);
-							if (cameraFrustum.isBoxVisible(chunkPos, chunkPos + glm::vec3(16, 16, 16)))
-							{
-								DrawArraysIndirectCommand drawCommand;
-								g_logger_assert((*subChunks)[i]->numVertsUsed.load() > 0, "Sub Chunk should never have tried to upload 0 verts to GPU.");
-								drawCommand.baseInstance = 0;
-								drawCommand.instanceCount = 1;
-								drawCommand.count = (*subChunks)[i]->numVertsUsed;
-								drawCommand.first = (*subChunks)[i]->first;
-								if ((*subChunks)[i]->isBlendable)
-								{
-									blendableCommandBuffer->add(drawCommand, (*subChunks)[i]->chunkCoordinates, (*subChunks)[i]->subChunkLevel, playerPositionInChunkCoords, 0);
-								}
-								else
-								{
-									solidCommandBuffer->add(drawCommand, (*subChunks)[i]->chunkCoordinates, (*subChunks)[i]->subChunkLevel, playerPositionInChunkCoords, 0);
-								}
-							}
-
-							if ((*subChunks)[i]->state == SubChunkState::DoneRetesselating)
-							{
-								(*subChunks)[i]->numVertsUsed = 0;
-								(*subChunks)[i]->state = SubChunkState::Unloaded;
-								subChunks->freePool(i);
-							}
+							solidCommandBuffer->add(drawCommand, subChunk->chunkCoordinates, subChunk->subChunkLevel, playerPositionInChunkCoords, 0);
 						}
 					}
 				}
-			}
+			});
 
 			glm::vec3 tint = glm::vec3(1.0f);
 			if (World::isPlayerUnderwater())
@@ -968,7 +1706,7 @@ namespace Minecraft
 				glBindVertexArray(globalVao);
 				opaqueShader.bind();
 				opaqueShader.uploadVec3("uPlayerPosition", playerPosition);
-				opaqueShader.uploadInt("uChunkRadius", World::ChunkRadius);
+				opaqueShader.uploadInt("uChunkRadius", chunkRadius);
 				opaqueShader.uploadVec3("uTint", tint);
 				glMultiDrawArraysIndirect(GL_TRIANGLES, NULL, solidCommandBuffer->getNumCommands(), sizeof(DrawCommand));
 				solidCommandBuffer->softReset();
@@ -1004,7 +1742,7 @@ namespace Minecraft
 
 				transparentShader.bind();
 				transparentShader.uploadVec3("uPlayerPosition", playerPosition);
-				transparentShader.uploadInt("uChunkRadius", World::ChunkRadius);
+				transparentShader.uploadInt("uChunkRadius", chunkRadius);
 				transparentShader.uploadVec3("uTint", tint);
 
 				glBindVertexArray(globalVao);
@@ -1035,174 +1773,834 @@ namespace Minecraft
 				glBindTexture(GL_TEXTURE_2D, mainFramebuffer.getColorAttachment(2).graphicsId);
 				compositeShader.uploadInt("revealTexture", 1);
 
-				glBindVertexArray(Vertices::fullScreenSpaceRectangleVao);
-				glDrawArrays(GL_TRIANGLES, 0, 6);
+				glBindVertexArray(Vertices::fullScreenSpaceRectangleVao);
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+
+				glDepthFunc(GL_LESS);
+			}
+		}
+
+		void checkChunkRadius(const glm::vec3& playerPosition)
+		{
+			lastCheckedPlayerPosition = playerPosition;
+			hasCheckedPlayerPosition = true;
+
+			glm::ivec2 playerPosChunkCoords = World::toChunkCoords(playerPosition);
+			chunkWorker->setPlayerPosChunkCoords(playerPosChunkCoords);
+
+			// The server never renders, so this is the only place its sub-chunk events get drained
+			processSubChunkEvents();
+
+			unloadOutOfRangeChunks(playerPosChunkCoords);
+			loadChunksInRange(playerPosChunkCoords);
+		}
+
+		void setChunkRadius(int radius)
+		{
+			radius = glm::clamp(radius, (int)World::MinChunkRadius, (int)World::MaxChunkRadius);
+			Settings::Chunks::chunkRadius = (uint32)radius;
+			if (!chunkWorker || radius == chunkRadius)
+			{
+				// Nothing is loaded yet, init picks the new radius up
+				return;
+			}
+
+			g_logger_info("Changing the render distance from %d to %d chunks.", chunkRadius, radius);
+
+			// The block pool, sub-chunks, command buffers and GPU buffers are all sized for the radius,
+			// so save everything and start over with new ones. Freeing waits for the saves to finish
+			bool wasHeadless = isHeadless;
+			bool hadPlayerPosition = hasCheckedPlayerPosition;
+			glm::vec3 playerPosition = lastCheckedPlayerPosition;
+			serialize();
+			free();
+			init(wasHeadless);
+
+			if (hadPlayerPosition)
+			{
+				checkChunkRadius(playerPosition);
+			}
+		}
+
+		int getChunkRadius()
+		{
+			return chunkRadius > 0 ? chunkRadius : (int)Settings::Chunks::chunkRadius;
+		}
+
+		void setGreedyMeshing(bool enabled)
+		{
+			if (Settings::Chunks::greedyMeshing == enabled)
+			{
+				return;
+			}
+
+			Settings::Chunks::greedyMeshing = enabled;
+			if (!chunkWorker)
+			{
+				return;
+			}
+
+			std::vector<Chunk*> chunksToMesh;
+			chunks.forEach([&](Chunk& chunk)
+			{
+				chunksToMesh.push_back(&chunk);
+			});
+
+			for (Chunk* chunk : chunksToMesh)
+			{
+				queueRetesselateChunk(chunk->chunkCoords, chunk);
+			}
+		}
+
+		void pregenerate(const glm::vec3& centerPosition, int radius)
+		{
+			g_logger_assert(isHeadless, "Pregenerating a world is only supported in headless mode.");
+			auto start = std::chrono::steady_clock::now();
+
+			pregenCenter = World::toChunkCoords(centerPosition);
+			pregenRadius = radius;
+			uint32 numChunks = 0;
+			for (int z = -radius; z <= radius; z++)
+			{
+				for (int x = -radius; x <= radius; x++)
+				{
+					if ((x * x) + (z * z) <= radius * radius)
+					{
+						numChunks++;
+					}
+				}
+			}
+
+			// The radius can be much bigger than what fits in memory at once, so sweep a window across it
+			// like a player flying over the area. Each window fully covers the square inscribed in its
+			// circle, so spacing the windows by that square's width covers everything
+			const int halfWindowWidth = (int)((float)chunkRadius / glm::sqrt(2.0f));
+			const int windowSpacing = (halfWindowWidth * 2) + 1;
+			const int numWindowsFromCenter = glm::max((radius - halfWindowWidth + windowSpacing - 1) / windowSpacing, 0);
+			std::vector<glm::ivec2> windows;
+			for (int wz = -numWindowsFromCenter; wz <= numWindowsFromCenter; wz++)
+			{
+				for (int i = -numWindowsFromCenter; i <= numWindowsFromCenter; i++)
+				{
+					// Snake back and forth so each window shares as many chunks as possible with the last one
+					int wx = (wz % 2 == 0) ? i : -i;
+					glm::ivec2 offset = glm::ivec2(wx, wz) * windowSpacing;
+					glm::ivec2 closest = glm::max(glm::abs(offset) - halfWindowWidth, glm::ivec2(0));
+					if ((closest.x * closest.x) + (closest.y * closest.y) <= radius * radius)
+					{
+						windows.push_back(pregenCenter + offset);
+					}
+				}
+			}
+
+			g_logger_info("Pregenerating %u chunks in %d windows using %d worker threads.", numChunks, (int)windows.size(), processorCount);
+			for (int i = 0; i < (int)windows.size(); i++)
+			{
+				const glm::ivec2& window = windows[i];
+				g_logger_info("Pregenerating window %d/%d at chunk <%d, %d>.", i + 1, (int)windows.size(), window.x, window.y);
+				chunkWorker->setPlayerPosChunkCoords(window);
+
+				// Let the last window finish saving first, otherwise there might not be enough block data to go around
+				while (!unloadOutOfRangeChunks(window))
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+
+				while (true)
+				{
+					loadChunksInRange(window);
+
+					// Lit is as far as chunks go without meshing
+					bool isWindowDone = true;
+					for (int z = window.y - chunkRadius; z <= window.y + chunkRadius && isWindowDone; z++)
+					{
+						for (int x = window.x - chunkRadius; x <= window.x + chunkRadius; x++)
+						{
+							glm::ivec2 chunkCoords = glm::ivec2(x, z);
+							if (!isInLoadArea(chunkCoords, window))
+							{
+								continue;
+							}
+
+							const Chunk* chunk = getChunk(chunkCoords);
+							if (!chunk || chunk->state != ChunkState::Loaded || chunk->stage < ChunkStage::Lit)
+							{
+								isWindowDone = false;
+								break;
+							}
+						}
+					}
+
+					if (isWindowDone)
+					{
+						break;
+					}
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			}
+
+			// Save whatever is left and wait for the disk to catch up
+			serialize();
+			while (true)
+			{
+				bool isSaving = false;
+				chunks.forEach([&](const Chunk& chunk)
+				{
+					if (chunk.state.load(std::memory_order_acquire) != ChunkState::Unloading)
+					{
+						isSaving = true;
+					}
+				});
+
+				if (!isSaving)
+				{
+					break;
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+
+			float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+			g_logger_info("Pregenerated %u chunks in %2.3f seconds (%2.3f chunks/second).", numChunks, seconds, (float)numChunks / glm::max(seconds, 0.001f));
+			chunkWorker->logCommandStats();
+			MemoryTracker::logUsage();
+		}
+
+		// Returns true once every chunk outside the load area has been saved and unloaded
+		static bool unloadOutOfRangeChunks(const glm::ivec2& playerPosChunkCoords)
+		{
+			// Remove out of range chunks. This has to look at every chunk and not just the ones with
+			// sub-chunks, since a chunk might have been left behind before it ever got meshed
+			std::vector<Chunk*> chunksToSave;
+			std::vector<Chunk*> chunksToUnload;
+			bool isSaving = false;
+			chunks.forEach([&](Chunk& chunk)
+			{
+				// Pairs with the release in the I/O thread, so a chunk seen as Unloading is done being saved
+				ChunkState state = chunk.state.load(std::memory_order_acquire);
+				if (state == ChunkState::Loaded)
+				{
+					if (!isInLoadArea(chunk.chunkCoords, playerPosChunkCoords))
+					{
+						chunksToSave.push_back(&chunk);
+					}
+				}
+				else if (state == ChunkState::Unloading)
+				{
+					chunksToUnload.push_back(&chunk);
+				}
+				else if (state == ChunkState::Saving)
+				{
+					isSaving = true;
+				}
+			});
+
+			for (Chunk* chunk : chunksToSave)
+			{
+				queueSaveChunk(chunk->chunkCoords);
+			}
+
+			// Unload any chunks that have been deserialized
+			{
+				std::lock_guard<std::mutex> lock(chunkMtx);
+				for (Chunk* chunk : chunksToUnload)
+				{
+					// Commands on any chunk in the neighborhood can read this one. Nothing new can be queued
+					// against it while we hold the chunk mutex, so once they're all unpinned it's safe to go.
+					// Otherwise it stays Unloading and gets another try next time
+					if (isNeighborhoodPinned(chunk))
+					{
+						isSaving = true;
+						continue;
+					}
+
+					if (chunk->topNeighbor)
+					{
+						chunk->topNeighbor->bottomNeighbor = nullptr;
+					}
+					if (chunk->bottomNeighbor)
+					{
+						chunk->bottomNeighbor->topNeighbor = nullptr;
+					}
+					if (chunk->leftNeighbor)
+					{
+						chunk->leftNeighbor->rightNeighbor = nullptr;
+					}
+					if (chunk->rightNeighbor)
+					{
+						chunk->rightNeighbor->leftNeighbor = nullptr;
+					}
+
+					// Only lit chunks are worth keeping, anything earlier would have to be redone anyway
+					if (chunk->stage >= ChunkStage::Lit)
+					{
+						// Any neighbor decorated after this point means the cached light can't be trusted
+						std::vector<ChunkData*> evicted;
+						chunkCache.insert(chunk->chunkCoords, chunk->data, decorationSequence, evicted);
+						for (ChunkData* evictedData : evicted)
+						{
+							freeChunkData(evictedData);
+						}
+					}
+					else
+					{
+						freeChunkData(chunk->data);
+					}
+					// Anything still queued against this slot belongs to a chunk that no longer exists
+					chunkGenerations[getChunkSlot(chunk)]++;
+					chunks.erase(chunk->chunkCoords);
+				}
+			}
+
+			return chunksToSave.size() == 0 && !isSaving;
+		}
+
+		static bool isNeighborhoodPinned(const Chunk* chunk)
+		{
+			for (int z = -1; z <= 1; z++)
+			{
+				for (int x = -1; x <= 1; x++)
+				{
+					const Chunk* neighbor = (x == 0 && z == 0) ? chunk : getChunk(chunk->chunkCoords + glm::ivec2(x, z));
+					if (neighbor && neighbor->pinCount.load(std::memory_order_acquire) > 0)
+					{
+						return true;
+					}
+				}
+			}
+
+			return false;
+		}
+
+		static void loadChunksInRange(const glm::ivec2& playerPosChunkCoords)
+		{
+			// Load any chunks that need to be
+			bool needsWork = false;
+			for (int y = playerPosChunkCoords.y - chunkRadius; y <= playerPosChunkCoords.y + chunkRadius; y++)
+			{
+				for (int x = playerPosChunkCoords.x - chunkRadius; x <= playerPosChunkCoords.x + chunkRadius; x++)
+				{
+					glm::ivec2 position(x, y);
+					if (isInLoadArea(position, playerPosChunkCoords))
+					{
+						// We have to expand in a circle that exceeds the range of chunks in this radius,
+						// so we also have to make sure that we check if the chunk is in range before we
+						// try to queue it. Otherwise, we end up with infinite queues that instantly get deleted
+						// which clog our threads with empty work.
+						needsWork = true;
+						ChunkManager::queueCreateChunk(position);
+					}
+				}
+			}
+
+			ChunkManager::patchChunkPointers();
+
+			// Chunks on the old edge of the radius may have been waiting on neighbors that are now
+			// out of range, or that just started saving, so give every chunk a chance to advance
+			std::vector<Chunk*> allChunks;
+			allChunks.reserve(chunks.size());
+			chunks.forEach([&](Chunk& chunk)
+			{
+				allChunks.push_back(&chunk);
+			});
+
+			{
+				std::lock_guard<std::mutex> lock(chunkMtx);
+				for (Chunk* chunk : allChunks)
+				{
+					queueNextChunkStage(chunk);
+				}
+			}
+
+			if (needsWork)
+			{
+				chunkWorker->beginWork();
+			}
+		}
+
+		static bool isInLoadArea(const glm::ivec2& chunkCoords, const glm::ivec2& playerPosChunkCoords)
+		{
+			glm::ivec2 localPos = chunkCoords - playerPosChunkCoords;
+			if ((localPos.x * localPos.x) + (localPos.y * localPos.y) > (chunkRadius * chunkRadius))
+			{
+				return false;
+			}
+
+			if (pregenRadius >= 0)
+			{
+				glm::ivec2 pregenPos = chunkCoords - pregenCenter;
+				return (pregenPos.x * pregenPos.x) + (pregenPos.y * pregenPos.y) <= (pregenRadius * pregenRadius);
+			}
+
+			return true;
+		}
+
+		static void queueRetesselateLevels(Chunk* chunk, uint16 levels)
+		{
+			FillChunkCommand cmd;
+			cmd.type = CommandType::TesselateVertices;
+			cmd.subChunks = subChunks;
+			cmd.chunk = chunk;
+			cmd.levelsToMesh = levels;
+			chunkWorker->queueCommand(cmd);
+		}
+
+		// TODO: Simplify me!
+		static void retesselateChunkBlockUpdate(const glm::ivec2& chunkCoords, const glm::vec3& worldPosition, Chunk* chunk)
+		{
+			// Get any neighboring chunks that need to be updated
+			int numChunksToUpdate = 1;
+			Chunk* chunksToUpdate[3];
+			chunksToUpdate[0] = chunk;
+			glm::ivec3 localPosition = glm::floor(worldPosition - glm::vec3(chunkCoords.x * 16.0f, 0.0f, chunkCoords.y * 16.0f));
+			// Only the sub-chunks that can see this block, instead of the whole chunk
+			uint16 levels = getLevelsTouching(localPosition.y);
+			if (localPosition.x == 0)
+			{
+				if (chunk->bottomNeighbor)
+				{
+					chunksToUpdate[numChunksToUpdate++] = chunk->bottomNeighbor;
+				}
+			}
+			else if (localPosition.x == 15)
+			{
+				if (chunk->topNeighbor)
+				{
+					chunksToUpdate[numChunksToUpdate++] = chunk->topNeighbor;
+				}
+			}
+			if (localPosition.z == 0)
+			{
+				if (chunk->leftNeighbor)
+				{
+					chunksToUpdate[numChunksToUpdate++] = chunk->leftNeighbor;
+				}
+			}
+			else if (localPosition.z == 15)
+			{
+				if (chunk->rightNeighbor)
+				{
+					chunksToUpdate[numChunksToUpdate++] = chunk->rightNeighbor;
+				}
+			}
+
+			// Queue up all the chunks
+			queueRetesselateLevels(chunk, levels);
+			for (int i = 1; i < numChunksToUpdate; i++)
+			{
+				// Neighbors that haven't been meshed yet will be once their neighborhood is lit
+				if (chunksToUpdate[i]->stage == ChunkStage::Meshed)
+				{
+					queueRetesselateLevels(chunksToUpdate[i], levels);
+				}
+			}
+			chunkWorker->beginWork();
+		}
+
+		static Chunk* addChunk(const glm::ivec2& chunkCoordinates, ChunkState state, ChunkData* cachedData, uint32 cachedSequence)
+		{
+			ChunkData* chunkData = cachedData;
+			if (!chunkData)
+			{
+				// Cached chunks are already saved, so they're the first thing to go when block data is over budget
+				while (MemoryTracker::isOverBudget(MemoryTag::ChunkBlocks, sizeof(ChunkData)))
+				{
+					ChunkData* evictedData = chunkCache.evictOldest();
+					if (!evictedData)
+					{
+						break;
+					}
+					freeChunkData(evictedData);
+				}
+
+				if (MemoryTracker::isOverBudget(MemoryTag::ChunkBlocks, sizeof(ChunkData)))
+				{
+					// Back off instead of going over, the chunk gets another try once others have unloaded
+					if (!isOverBlockBudget)
+					{
+						g_logger_warning("Chunk block data is over its budget, waiting for chunks to unload.");
+						isOverBlockBudget = true;
+					}
+					return nullptr;
+				}
+				isOverBlockBudget = false;
+
+				chunkData = newChunkData();
+			}
+			if (!chunkData)
+			{
+				// Cached chunks are already saved, so their data can be reused as is
+				chunkData = chunkCache.evictOldest();
+				if (!chunkData)
+				{
+					// What do we do if there were no free blocks?
+					g_logger_warning("No free pools for block data.");
+					return nullptr;
+				}
+			}
+
+			Chunk* chunk = nullptr;
+			{
+				// Workers schedule stages under this lock, so they never see a chunk that's half set up
+				std::lock_guard<std::mutex> lock(chunkMtx);
+
+				// Cached light was spread from the neighbors this chunk had back then. If any of them has
+				// been decorated since, its blocks changed and the old light could be too bright, and
+				// spreading light only ever raises it. So light it from scratch like a chunk from disk.
+				// This has to happen before the chunk is visible to the workers
+				bool cachedLightIsValid = cachedData != nullptr;
+				for (int z = -1; z <= 1 && cachedLightIsValid; z++)
+				{
+					for (int x = -1; x <= 1; x++)
+					{
+						Chunk* neighbor = getChunk(chunkCoordinates + glm::ivec2(x, z));
+						if (neighbor && neighbor->decoratedSequence > cachedSequence)
+						{
+							cachedLightIsValid = false;
+							break;
+						}
+					}
+				}
+				if (cachedData && !cachedLightIsValid)
+				{
+					cachedData->clearLight();
+				}
+
+				chunk = chunks.insert(chunkCoordinates);
+				if (!chunk)
+				{
+					freeChunkData(chunkData);
+					return nullptr;
+				}
 
-				glDepthFunc(GL_LESS);
+				chunk->data = chunkData;
+
+				chunk->state = state;
+				chunk->stage = ChunkStage::Empty;
+				// The caller queues the first stage
+				chunk->stageQueued = true;
+				chunk->queuedCommands = 0;
+				chunk->meshVersion = 0;
+				chunk->levelsToMesh = 0;
+				chunk->hasCachedLight = cachedLightIsValid;
+				chunk->decoratedSequence = 0;
+				for (uint32& retiredMeshVersion : chunk->retiredMeshVersions)
+				{
+					retiredMeshVersion = 0;
+				}
+				chunk->subChunkIndices.clear();
+				chunkGenerations[getChunkSlot(chunk)]++;
+
+				// Link this chunk into its neighbors right away, otherwise a neighbor could run a
+				// stage before patchChunkPointers and miss this chunk completely
+				chunk->topNeighbor = getChunk(chunkCoordinates + INormals2::Up);
+				chunk->bottomNeighbor = getChunk(chunkCoordinates + INormals2::Down);
+				chunk->leftNeighbor = getChunk(chunkCoordinates + INormals2::Left);
+				chunk->rightNeighbor = getChunk(chunkCoordinates + INormals2::Right);
+				if (chunk->topNeighbor)
+				{
+					chunk->topNeighbor->bottomNeighbor = chunk;
+				}
+				if (chunk->bottomNeighbor)
+				{
+					chunk->bottomNeighbor->topNeighbor = chunk;
+				}
+				if (chunk->leftNeighbor)
+				{
+					chunk->leftNeighbor->rightNeighbor = chunk;
+				}
+				if (chunk->rightNeighbor)
+				{
+					chunk->rightNeighbor->leftNeighbor = chunk;
+				}
 			}
+
+			return chunk;
 		}
 
-		void checkChunkRadius(const glm::vec3& playerPosition)
+		// Chunks around this one that came back from the cache but haven't been lit yet were lit against
+		// its old blocks, so they have to light themselves from scratch instead
+		static void markChunkDecorated(Chunk* chunk)
 		{
-			glm::ivec2 playerPosChunkCoords = World::toChunkCoords(playerPosition);
-			chunkWorker->setPlayerPosChunkCoords(playerPosChunkCoords);
-			static glm::ivec2 lastPlayerPosChunkCoords = playerPosChunkCoords;
-
-			// Remove out of range chunks
-			for (int i = 0; i < (int)subChunks->size(); i++)
+			std::lock_guard<std::mutex> lock(chunkMtx);
+			chunk->decoratedSequence = ++decorationSequence;
+			for (int z = -1; z <= 1; z++)
 			{
-				if ((*subChunks)[i]->state != SubChunkState::Unloaded)
+				for (int x = -1; x <= 1; x++)
 				{
-					glm::ivec2 chunkPos = (*subChunks)[i]->chunkCoordinates;
-					const glm::ivec2 localChunkPos = chunkPos - playerPosChunkCoords;
-					bool inRangeOfPlayer =
-						(localChunkPos.x * localChunkPos.x) + (localChunkPos.y * localChunkPos.y) <=
-						(World::ChunkRadius * World::ChunkRadius);
-					if (!inRangeOfPlayer)
+					Chunk* neighbor = getChunk(chunk->chunkCoords + glm::ivec2(x, z));
+					if (neighbor && neighbor != chunk && neighbor->hasCachedLight)
 					{
-						auto iter = chunks.find(chunkPos);
-						if (iter != chunks.end() && iter->second.state != ChunkState::Saving)
-						{
-							if (iter->second.state != ChunkState::Saving)
-							{
-								queueSaveChunk((*subChunks)[i]->chunkCoordinates);
-							}
-						}
+						neighbor->hasCachedLight = false;
+						neighbor->data->clearLight();
 					}
 				}
 			}
+		}
 
-			// Unload any chunks that have been deserialized
-			for (auto iter = chunks.begin(); iter != chunks.end();)
+		// Light from an edit can reach up to 15 blocks, so it may have spilled into any chunk around this one.
+		// Cached copies of those would come back with the old light
+		static void dropCachedNeighbors(const glm::ivec2& chunkCoords)
+		{
+			for (int z = -1; z <= 1; z++)
 			{
-				if (iter->second.state == ChunkState::Unloading)
-				{
-					DebugStats::totalChunkRamUsed = DebugStats::totalChunkRamUsed - (float)(blockPool->poolSize() * sizeof(Block));
-
-					chunkFreeList.push_back(iter->second.data);
-					iter = chunks.erase(iter);
-				}
-				else
+				for (int x = -1; x <= 1; x++)
 				{
-					iter++;
+					ChunkData* cachedData = chunkCache.take(chunkCoords + glm::ivec2(x, z));
+					if (cachedData)
+					{
+						freeChunkData(cachedData);
+					}
 				}
 			}
+		}
+
+		static uint32 getChunkSlot(const Chunk* chunk)
+		{
+			return blockPool->getPoolIndex(chunk->data);
+		}
+
+		// Returns nullptr when every slot in the block pool is taken
+		static ChunkData* newChunkData()
+		{
+			ChunkData* chunkData = blockPool->tryGetNewPool();
+			if (chunkData)
+			{
+				// The pool only hands out raw memory
+				new(chunkData) ChunkData();
+				MemoryTracker::add(MemoryTag::ChunkBlocks, sizeof(ChunkData));
+			}
+			return chunkData;
+		}
+
+		static void freeChunkData(ChunkData* chunkData)
+		{
+			uint32 slot = blockPool->getPoolIndex(chunkData);
+			chunkData->~ChunkData();
+			MemoryTracker::remove(MemoryTag::ChunkBlocks, sizeof(ChunkData));
+			// Nothing needs the memory until the slot is handed out again, so don't let it count against us
+			blockPool->releasePool(slot);
+			blockPool->freePool(slot);
+		}
+
+		static void tagChunkCommand(FillChunkCommand& command)
+		{
+			command.chunkSlot = getChunkSlot(command.chunk);
+			command.chunkGeneration = chunkGenerations[command.chunkSlot];
+		}
 
-			// If the player moves to a new chunk, then retesselate any chunks on the edge of the chunk radius to 
-			// fix any holes there might be
-			bool retesselateEdges = false;
-			if (lastPlayerPosChunkCoords != playerPosChunkCoords)
+		static bool isCommandStale(const FillChunkCommand& command)
+		{
+			if (chunkGenerations[command.chunkSlot] != command.chunkGeneration)
 			{
-				retesselateEdges = true;
+				return true;
 			}
 
-			// Load/retesselate any chunks that need to be
-			bool needsWork = false;
-			for (int y = playerPosChunkCoords.y - World::ChunkRadius; y <= playerPosChunkCoords.y + World::ChunkRadius; y++)
+			// Anything queued after the save bumped the generation still matches it, but once a chunk
+			// is on its way out only the save is allowed to touch it. The command's pin keeps the chunk
+			// itself alive long enough to check
+			return command.type != CommandType::SaveBlockData && command.chunk->state != ChunkState::Loaded;
+		}
+
+		static void queueSubChunkEvent(const SubChunkEvent& event)
+		{
+			subChunkEvents->push(event);
+		}
+
+		static void processSubChunkEvents()
+		{
+			SubChunkEvent event;
+			while (subChunkEvents->tryPop(event))
 			{
-				for (int x = playerPosChunkCoords.x - World::ChunkRadius; x <= playerPosChunkCoords.x + World::ChunkRadius; x++)
+				Chunk* chunk = chunks.resolve(event.chunk);
+				if (chunk && chunk->state != ChunkState::Loaded)
 				{
-					glm::ivec2 position(x, y);
-					glm::ivec2 localPos = playerPosChunkCoords - position;
-					if ((localPos.x * localPos.x) + (localPos.y * localPos.y) <= (World::ChunkRadius * World::ChunkRadius))
+					chunk = nullptr;
+				}
+
+				if (event.type == SubChunkEventType::Uploaded)
+				{
+					SubChunk* subChunk = (*subChunks)[event.subChunkIndex];
+					if (chunk && subChunk->meshVersion >= chunk->retiredMeshVersions[subChunk->subChunkLevel])
 					{
-						// We have to expand in a circle that exceeds the range of chunks in this radius,
-						// so we also have to make sure that we check if the chunk is in range before we
-						// try to queue it. Otherwise, we end up with infinite queues that instantly get deleted
-						// which clog our threads with empty work.
-						needsWork = true;
-						glm::ivec2 lastLocalPos = lastPlayerPosChunkCoords - position;
-						bool retesselateThisChunk =
-							(lastLocalPos.x * lastLocalPos.x) + (lastLocalPos.y * lastLocalPos.y) >= ((World::ChunkRadius - 1) * (World::ChunkRadius - 1))
-							&& retesselateEdges;
-						if (!retesselateThisChunk)
+						subChunk->state = SubChunkState::Uploaded;
+						chunk->subChunkIndices.push_back(event.subChunkIndex);
+					}
+					else
+					{
+						// The chunk is gone, or a newer mesh finished before this one did
+						freeSubChunk(event.subChunkIndex);
+					}
+				}
+				else if (event.type == SubChunkEventType::MeshFinished)
+				{
+					// Meshes of single levels finish out of order with meshes of the whole chunk, so each level
+					// only retires sub-chunks for meshes newer than the last one that finished there
+					uint16 retiredLevels = 0;
+					if (chunk)
+					{
+						for (int level = 0; level < 16; level++)
 						{
-							ChunkManager::queueCreateChunk(position);
+							if ((event.levels & (1 << level)) && event.meshVersion > chunk->retiredMeshVersions[level])
+							{
+								chunk->retiredMeshVersions[level] = event.meshVersion;
+								retiredLevels |= (uint16)(1 << level);
+							}
 						}
-						else
+					}
+
+					if (retiredLevels)
+					{
+						// Every sub-chunk of this mesh was uploaded before this event, so anything older in those levels can go
+						auto newEnd = std::remove_if(chunk->subChunkIndices.begin(), chunk->subChunkIndices.end(), [&](uint32 subChunkIndex)
 						{
-							ChunkManager::queueRetesselateChunk(position);
-						}
+							const SubChunk* subChunk = (*subChunks)[subChunkIndex];
+							if ((retiredLevels & (1 << subChunk->subChunkLevel)) && subChunk->meshVersion < event.meshVersion)
+							{
+								freeSubChunk(subChunkIndex);
+								return true;
+							}
+							return false;
+						});
+						chunk->subChunkIndices.erase(newEnd, chunk->subChunkIndices.end());
 					}
 				}
 			}
+		}
 
-			ChunkManager::queueGenerateDecorations(playerPosChunkCoords);
-			ChunkManager::queueCalculateLighting(playerPosChunkCoords);
-			lastPlayerPosChunkCoords = playerPosChunkCoords;
-
-			ChunkManager::patchChunkPointers();
-			if (needsWork)
+		static void freeSubChunk(uint32 subChunkIndex)
+		{
+			SubChunk* subChunk = (*subChunks)[subChunkIndex];
+			if (subChunk->vertexAllocation != TlsfAllocator::InvalidHandle)
 			{
-				chunkWorker->beginWork();
+				std::lock_guard<std::mutex> lock(vertexAllocatorMtx);
+				vertexAllocator.free(subChunk->vertexAllocation);
+				subChunk->vertexAllocation = TlsfAllocator::InvalidHandle;
+				MemoryTracker::remove(MemoryTag::SubChunkVertices, (size_t)subChunk->numVertsUsed * sizeof(Vertex));
 			}
+
+			subChunk->state = SubChunkState::Unloaded;
+			subChunk->numVertsUsed = 0;
+			subChunks->freePool(subChunkIndex);
 		}
 
-		// TODO: Simplify me!
-		static void retesselateChunkBlockUpdate(const glm::ivec2& chunkCoords, const glm::vec3& worldPosition, Chunk* chunk)
+		static bool allocateSubChunkVertices(SubChunk* subChunk, uint32 numVertices)
 		{
-			FillChunkCommand cmd;
-			cmd.type = CommandType::TesselateVertices;
-			cmd.subChunks = subChunks;
-			cmd.chunk = chunk;
-
-			// Get any neighboring chunks that need to be updated
-			int numChunksToUpdate = 1;
-			Chunk* chunksToUpdate[3];
-			chunksToUpdate[0] = chunk;
-			glm::ivec3 localPosition = glm::floor(worldPosition - glm::vec3(chunkCoords.x * 16.0f, 0.0f, chunkCoords.y * 16.0f));
-			if (localPosition.x == 0)
+			size_t numBytes = (size_t)numVertices * sizeof(Vertex);
+			TlsfAllocator::Allocation allocation;
 			{
-				if (chunk->bottomNeighbor)
+				std::lock_guard<std::mutex> lock(vertexAllocatorMtx);
+				if (MemoryTracker::isOverBudget(MemoryTag::SubChunkVertices, numBytes) || !vertexAllocator.allocate(numVertices, allocation))
 				{
-					chunksToUpdate[numChunksToUpdate++] = chunk->bottomNeighbor;
+					return false;
 				}
+				MemoryTracker::add(MemoryTag::SubChunkVertices, numBytes);
 			}
-			else if (localPosition.x == 15)
+
+			subChunk->first = allocation.offset;
+			subChunk->vertexAllocation = allocation.handle;
+			subChunk->numVertsUsed = numVertices;
+			return true;
+		}
+
+		static Vertex* getSubChunkVertices(const SubChunk* subChunk)
+		{
+			return vertexBasePointer + subChunk->first;
+		}
+
+		static void completeChunkStage(Chunk* chunk, ChunkStage stage)
+		{
+			std::lock_guard<std::mutex> lock(chunkMtx);
+			chunk->stage = stage;
+			chunk->stageQueued = false;
+
+			// This chunk is part of the neighborhood of all 8 chunks around it, so any of them
+			// (and this chunk itself) may be able to advance now
+			for (int z = -1; z <= 1; z++)
 			{
-				if (chunk->topNeighbor)
+				for (int x = -1; x <= 1; x++)
 				{
-					chunksToUpdate[numChunksToUpdate++] = chunk->topNeighbor;
+					Chunk* neighbor = getChunk(chunk->chunkCoords + glm::ivec2(x, z));
+					if (neighbor)
+					{
+						queueNextChunkStage(neighbor);
+					}
 				}
 			}
-			if (localPosition.z == 0)
+		}
+
+		// Must be called with chunkMtx locked
+		static void queueNextChunkStage(Chunk* chunk)
+		{
+			if (chunk->stageQueued || chunk->state != ChunkState::Loaded)
 			{
-				if (chunk->leftNeighbor)
-				{
-					chunksToUpdate[numChunksToUpdate++] = chunk->leftNeighbor;
-				}
+				return;
 			}
-			else if (localPosition.z == 15)
+
+			CommandType type;
+			ChunkStage stage = chunk->stage;
+			switch (stage)
 			{
-				if (chunk->rightNeighbor)
+			case ChunkStage::Generated:
+				type = CommandType::GenerateDecorations;
+				break;
+			case ChunkStage::Decorated:
+				type = CommandType::CalculateLighting;
+				break;
+			case ChunkStage::Lit:
+				if (isHeadless)
 				{
-					chunksToUpdate[numChunksToUpdate++] = chunk->rightNeighbor;
+					// Nothing to render, so lighting is the last stage
+					return;
 				}
+				type = CommandType::TesselateVertices;
+				break;
+			default:
+				// Empty chunks get their first command when they're created and meshed chunks are done
+				return;
+			}
+
+			if (!neighborsReachedStage(chunk, stage))
+			{
+				return;
 			}
 
-			// Update the sub-chunks that are about to be deleted
-			for (int i = 0; i < (int)subChunks->size(); i++)
+			chunk->stageQueued = true;
+			FillChunkCommand cmd;
+			cmd.type = type;
+			cmd.chunk = chunk;
+			cmd.subChunks = subChunks;
+			// The first mesh of a chunk covers all of it
+			cmd.levelsToMesh = AllChunkLevels;
+			chunkWorker->queueCommand(cmd);
+		}
+
+		// Must be called with chunkMtx locked
+		static bool neighborsReachedStage(const Chunk* chunk, ChunkStage stage)
+		{
+			glm::ivec2 playerPosChunkCoords = chunkWorker->getPlayerPosChunkCoords();
+			for (int z = -1; z <= 1; z++)
 			{
-				if ((*subChunks)[i]->state == SubChunkState::Uploaded)
+				for (int x = -1; x <= 1; x++)
 				{
-					for (int j = 0; j < numChunksToUpdate; j++)
+					glm::ivec2 neighborCoords = chunk->chunkCoords + glm::ivec2(x, z);
+					const Chunk* neighbor = getChunk(neighborCoords);
+					if (!neighbor || neighbor->state != ChunkState::Loaded)
 					{
-						if ((*subChunks)[i]->chunkCoordinates == chunksToUpdate[j]->chunkCoords)
+						// A neighbor that's outside the radius is never coming, so don't wait on it.
+						// This is what lets the chunks on the edge of the radius finish
+						if (isInLoadArea(neighborCoords, playerPosChunkCoords))
 						{
-							(*subChunks)[i]->state = SubChunkState::RetesselateVertices;
+							return false;
 						}
 					}
+					else if (neighbor->stage < stage)
+					{
+						return false;
+					}
 				}
 			}
 
-			// Queue up all the chunks
-			chunkWorker->queueCommand(cmd);
-			for (int i = 1; i < numChunksToUpdate; i++)
-			{
-				cmd.chunk = chunksToUpdate[i];
-				chunkWorker->queueCommand(cmd);
-			}
-			chunkWorker->beginWork();
+			return true;
 		}
 	}
 
@@ -1241,27 +2639,43 @@ namespace Minecraft
 		static const int LIGHT_COLOR_BITMASK_G = 0x03800;
 		static const int LIGHT_COLOR_BITMASK_B = 0x1C000;
 		static const int SKY_LIGHT_LEVEL_BITMASK = 0x3e0000;
+		static const int TILE_EXTENT_U_BITMASK = 0x3C00000;
+		static const int TILE_EXTENT_V_BITMASK = 0x3C000000;
 
 		static const int BASE_17_DEPTH = 17;
 		static const int BASE_17_WIDTH = 17;
 		static const int BASE_17_HEIGHT = 289;
 
+		// Chunk files start with a header and then hold each section either as a single block, when every
+		// block in it has the same id and light color, or as one Block per block. Files without the header
+		// are from before sections and are one Block per block for the whole chunk
+		static const uint32 CHUNK_FILE_MAGIC = 0x4B4E4843; // "CHNK"
+		static const uint32 CHUNK_FILE_VERSION = 1;
+		static const uint8 SECTION_UNIFORM = 0;
+		static const uint8 SECTION_RAW = 1;
+
 		// Internal functions
 		static int to1DArray(int x, int y, int z);
 		static Block getBlockInternal(const Chunk* chunk, int x, int y, int z);
 		static bool setBlockInternal(Chunk* chunk, int x, int y, int z, Block newBlock);
 		static bool removeBlockInternal(Chunk* chunk, int x, int y, int z);
+		static bool isSectionHidden(const ChunkSnapshot& snapshot, int sectionIndex);
+		static void buildFaceMasks(const ChunkSnapshot& snapshot, int level, FaceMasks& masks);
+		static void getVisibleFaces(const FaceMasks& masks, int localY, int x, uint32 outVisibleFaces[6]);
+		static int findLowestBit(uint32 value);
 		static std::string getFormattedFilepath(const glm::ivec2& chunkCoordinates, const std::string& worldSavePath);
-		static void loadBlock(Vertex* vertexData, const glm::ivec3& vert1, const glm::ivec3& vert2, const glm::ivec3& vert3, const glm::ivec3& vert4, const TextureFormat& texture, CUBE_FACE face, bool colorFaceBasedOnBiome, uint8_t lightLevelv1, uint8_t lightLevelv2, uint8_t lightLevelv3, uint8_t lightLevelv4, const glm::ivec3& lightColor, int skyLightLevel);
-		static void calculateNextLightLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_set<Chunk*>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck);
-		static void removeNextLightLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_set<Chunk*>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck, std::queue<glm::ivec3>& lightSources, bool ignoreThisSolidBlock);
+		static void loadBlock(Vertex* vertexData, const glm::ivec3& vert1, const glm::ivec3& vert2, const glm::ivec3& vert3, const glm::ivec3& vert4, uint16 textureId, CUBE_FACE face, bool colorFaceBasedOnBiome, uint8_t lightLevelv1, uint8_t lightLevelv2, uint8_t lightLevelv3, uint8_t lightLevelv4, const glm::ivec3& lightColor, int skyLightLevel, const glm::ivec2& quadSize = glm::ivec2(1, 1));
+		static uint64 packGreedyFace(uint16 textureId, bool colorFaceBasedOnBiome, uint8 lightLevel, int16 lightColor, int skyLightLevel);
+		static void mergeGreedyFaces(std::vector<Vertex>& vertices, uint64* greedyFaces, int level);
+		static void calculateNextLightLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck);
+		static void removeNextLightLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck, std::queue<glm::ivec3>& lightSources, bool ignoreThisSolidBlock);
 		// TODO: Consider removing this duplication if it doesn't effect performance
-		static void calculateNextSkyLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_set<Chunk*>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck);
-		static void removeNextSkyLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_set<Chunk*>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck, std::queue<glm::ivec3>& lightSources, bool ignoreThisSolidBlock);
+		static void calculateNextSkyLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck);
+		static void removeNextSkyLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck, std::queue<glm::ivec3>& lightSources, bool ignoreThisSolidBlock);
 
 		void info()
 		{
-			g_logger_info("%d size of chunk", sizeof(Block) * World::ChunkWidth * World::ChunkDepth * World::ChunkHeight);
+			g_logger_info("%d size of chunk", sizeof(ChunkData));
 			g_logger_info("Max %d size of vertex data", sizeof(Vertex) * World::ChunkWidth * World::ChunkHeight * World::ChunkDepth * 24);
 		}
 
@@ -1273,7 +2687,7 @@ namespace Minecraft
 			const int worldChunkX = chunkCoordinates.x * 16;
 			const int worldChunkZ = chunkCoordinates.y * 16;
 
-			g_memory_zeroMem(chunk->data, sizeof(Block) * World::ChunkWidth * World::ChunkHeight * World::ChunkDepth);
+			chunk->data->clear();
 			for (int x = 0; x < World::ChunkDepth; x++)
 			{
 				for (int z = 0; z < World::ChunkWidth; z++)
@@ -1287,252 +2701,283 @@ namespace Minecraft
 						if (y == 0)
 						{
 							// Bedrock
-							chunk->data[arrayExpansion].id = 7;
+							chunk->data->setId(arrayExpansion, 7);
 						}
 						else if (y < stoneHeight)
 						{
 							// Stone
-							chunk->data[arrayExpansion].id = 6;
+							chunk->data->setId(arrayExpansion, 6);
 						}
 						else if (y < maxHeight)
 						{
 							// Dirt
-							chunk->data[arrayExpansion].id = 4;
+							chunk->data->setId(arrayExpansion, 4);
 						}
 						else if (y == maxHeight)
 						{
 							if (maxHeight < oceanLevel + 2)
 							{
 								// Sand
-								chunk->data[arrayExpansion].id = 3;
+								chunk->data->setId(arrayExpansion, 3);
 							}
 							else
 							{
 								// Grass
-								chunk->data[arrayExpansion].id = 2;
+								chunk->data->setId(arrayExpansion, 2);
 							}
 						}
 						else if (y >= minBiomeHeight && y < oceanLevel)
 						{
 							// Water 
-							chunk->data[arrayExpansion].id = 19;
+							chunk->data->setId(arrayExpansion, 19);
 						}
-						else if (!chunk->data[arrayExpansion].id)
+						else if (!chunk->data->getId(arrayExpansion))
 						{
-							chunk->data[arrayExpansion].id = BlockMap::AIR_BLOCK.id;
+							chunk->data->setId(arrayExpansion, BlockMap::AIR_BLOCK.id);
 						}
 					}
 				}
 			}
+
+			// Most of the sky and everything under the surface ends up all one block
+			chunk->data->compact();
 		}
 
-		void generateDecorations(const glm::ivec2& lastPlayerLoadPosChunkCoords, float seed, const SimplexNoise& generator)
+		void generateDecorations(Chunk* chunk, float seed, const SimplexNoise& generator)
 		{
-			for (int chunkZ = lastPlayerLoadPosChunkCoords.y - World::ChunkRadius; chunkZ <= lastPlayerLoadPosChunkCoords.y + World::ChunkRadius; chunkZ++)
+			const int worldChunkX = chunk->chunkCoords.x * 16;
+			const int worldChunkZ = chunk->chunkCoords.y * 16;
+
+			for (int x = 0; x < World::ChunkDepth; x++)
 			{
-				for (int chunkX = lastPlayerLoadPosChunkCoords.x - World::ChunkRadius; chunkX <= lastPlayerLoadPosChunkCoords.x + World::ChunkRadius; chunkX++)
+				for (int z = 0; z < World::ChunkWidth; z++)
 				{
-					const int worldChunkX = chunkX * 16;
-					const int worldChunkZ = chunkZ * 16;
-
-					glm::ivec2 localChunkPos = glm::vec2(lastPlayerLoadPosChunkCoords.x - chunkX, lastPlayerLoadPosChunkCoords.y - chunkZ);
-					bool inRangeOfPlayer =
-						(localChunkPos.x * localChunkPos.x) + (localChunkPos.y * localChunkPos.y) <=
-						((World::ChunkRadius - 1) * (World::ChunkRadius - 1));
-					if (!inRangeOfPlayer)
-					{
-						// Skip over all chunks in range radius - 1
-						continue;
-					}
-
-					Chunk* chunk = ChunkManager::getChunk(glm::vec3(worldChunkX, 128.0f, worldChunkZ));
-					if (!chunk)
-					{
-						// TODO: Is this a problem...? It should only effect chunks on the edge of the border
-						// g_logger_error("Bad chunk when generating terrain. Skipping chunk.");
-						continue;
-					}
+					// Generate some trees if needed
+					int num = (rand() % 100);
+					bool generateTree = num > 98;
 
-					if (!chunk->needsToGenerateDecorations)
+					if (generateTree)
 					{
-						continue;
-					}
-					chunk->needsToGenerateDecorations = false;
+						int16 y = TerrainGenerator::getHeight(generator, x + worldChunkX, z + worldChunkZ, minBiomeHeight, maxBiomeHeight) + 1;
 
-					for (int x = 0; x < World::ChunkDepth; x++)
-					{
-						for (int z = 0; z < World::ChunkWidth; z++)
+						if (y > oceanLevel + 2)
 						{
-							// Generate some trees if needed
-							int num = (rand() % 100);
-							bool generateTree = num > 98;
-
-							if (generateTree)
+							// Generate a tree
+							int treeHeight = (rand() % 3) + 3;
+							int leavesBottomY = glm::clamp(treeHeight - 3, 3, (int)World::ChunkHeight - 1);
+							int leavesTopY = treeHeight + 1;
+							if (generateTree && (y + 1 + leavesTopY < World::ChunkHeight))
 							{
-								int16 y = TerrainGenerator::getHeight(generator, x + worldChunkX, z + worldChunkZ, minBiomeHeight, maxBiomeHeight) + 1;
+								for (int treeY = 0; treeY <= treeHeight; treeY++)
+								{
+									chunk->data->setId(to1DArray(x, treeY + y, z), 8);
+								}
 
-								if (y > oceanLevel + 2)
+								int ringLevel = 0;
+								for (int leavesY = leavesBottomY + y; leavesY <= leavesTopY + y; leavesY++)
 								{
-									// Generate a tree
-									int treeHeight = (rand() % 3) + 3;
-									int leavesBottomY = glm::clamp(treeHeight - 3, 3, (int)World::ChunkHeight - 1);
-									int leavesTopY = treeHeight + 1;
-									if (generateTree && (y + 1 + leavesTopY < World::ChunkHeight))
+									int leafRadius = leavesY == leavesTopY ? 2 : 1;
+									for (int leavesX = x - leafRadius; leavesX <= x + leafRadius; leavesX++)
 									{
-										for (int treeY = 0; treeY <= treeHeight; treeY++)
-										{
-											chunk->data[to1DArray(x, treeY + y, z)].id = 8;
-										}
-
-										int ringLevel = 0;
-										for (int leavesY = leavesBottomY + y; leavesY <= leavesTopY + y; leavesY++)
+										for (int leavesZ = z - leafRadius; leavesZ <= z + leafRadius; leavesZ++)
 										{
-											int leafRadius = leavesY == leavesTopY ? 2 : 1;
-											for (int leavesX = x - leafRadius; leavesX <= x + leafRadius; leavesX++)
+											if (leavesX < World::ChunkDepth && leavesX >= 0 && leavesZ < World::ChunkWidth && leavesZ >= 0)
+											{
+												chunk->data->setId(to1DArray(leavesX, leavesY, leavesZ), 9);
+											}
+											else if (leavesX < 0)
 											{
-												for (int leavesZ = z - leafRadius; leavesZ <= z + leafRadius; leavesZ++)
+												if (chunk->bottomNeighbor)
 												{
-													if (leavesX < World::ChunkDepth && leavesX >= 0 && leavesZ < World::ChunkWidth && leavesZ >= 0)
-													{
-														chunk->data[to1DArray(leavesX, leavesY, leavesZ)].id = 9;
-													}
-													else if (leavesX < 0)
-													{
-														if (chunk->bottomNeighbor)
-														{
-															chunk->bottomNeighbor->data[to1DArray(World::ChunkDepth + leavesX, leavesY, leavesZ)].id = 9;
-														}
-													}
-													else if (leavesX >= World::ChunkDepth)
-													{
-														if (chunk->topNeighbor)
-														{
-															chunk->topNeighbor->data[to1DArray(leavesX - World::ChunkDepth, leavesY, leavesZ)].id = 9;
-														}
-													}
-													else if (leavesZ < 0)
-													{
-														if (chunk->leftNeighbor)
-														{
-															chunk->leftNeighbor->data[to1DArray(leavesX, leavesY, World::ChunkWidth + leavesZ)].id = 9;
-														}
-													}
-													else if (leavesZ >= World::ChunkWidth)
-													{
-														if (chunk->rightNeighbor)
-														{
-															chunk->rightNeighbor->data[to1DArray(leavesX, leavesY, leavesZ - World::ChunkWidth)].id = 9;
-														}
-													}
+													chunk->bottomNeighbor->data->setId(to1DArray(World::ChunkDepth + leavesX, leavesY, leavesZ), 9);
+												}
+											}
+											else if (leavesX >= World::ChunkDepth)
+											{
+												if (chunk->topNeighbor)
+												{
+													chunk->topNeighbor->data->setId(to1DArray(leavesX - World::ChunkDepth, leavesY, leavesZ), 9);
+												}
+											}
+											else if (leavesZ < 0)
+											{
+												if (chunk->leftNeighbor)
+												{
+													chunk->leftNeighbor->data->setId(to1DArray(leavesX, leavesY, World::ChunkWidth + leavesZ), 9);
+												}
+											}
+											else if (leavesZ >= World::ChunkWidth)
+											{
+												if (chunk->rightNeighbor)
+												{
+													chunk->rightNeighbor->data->setId(to1DArray(leavesX, leavesY, leavesZ - World::ChunkWidth), 9);
 												}
 											}
-											ringLevel++;
 										}
 									}
+									ringLevel++;
 								}
 							}
 						}
 					}
 				}
 			}
+
+		}
+
+		static void calculateChunkLighting(Chunk* chunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate, int firstSkySection, const ChunkSnapshot& snapshot);
+		static int calculateChunkSkyBlocks(Chunk* chunk, const glm::ivec2& chunkCoordinates);
+		void calculateLighting(Chunk* chunk, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate, ChunkSnapshot& snapshot)
+		{
+			// Calculate all sky light levels first, then propagate the sky "sources" and light sources.
+			// Any light that floods into a neighbor that hasn't done this yet just gets raised again when it does
+			int firstSkySection = calculateChunkSkyBlocks(chunk, chunk->chunkCoords);
+			// Finding the sources only reads, so it can work off a copy. Flooding the light writes across
+			// chunk borders, so that still goes through the chunks themselves
+			snapshot.copyFrom(chunk);
+			calculateChunkLighting(chunk, chunk->chunkCoords, chunksToRetesselate, firstSkySection, snapshot);
 		}
 
-		static void calculateChunkLighting(Chunk* chunk, const glm::ivec2& chunkCoordinates);
-		static void calculateChunkSkyBlocks(Chunk* chunk, const glm::ivec2& chunkCoordinates);
-		void calculateLighting(const glm::ivec2& lastPlayerLoadPosChunkCoords)
+		void spreadCachedLight(Chunk* chunk, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate)
 		{
-			for (int i = 0; i < 2; i++)
+			// The chunk's own light is still right, but neighbors that were loaded while it was cached never
+			// got any of it and it never got theirs. Flooding out from the blocks on both sides of every
+			// border fixes both, since a flood only ever raises light levels
+			std::queue<glm::ivec3> blocksToUpdate = {};
+			std::queue<glm::ivec3> skyBlocksToUpdate = {};
+			auto addBorderBlock = [&](int x, int y, int z)
 			{
-				for (int chunkZ = lastPlayerLoadPosChunkCoords.y - World::ChunkRadius; chunkZ <= lastPlayerLoadPosChunkCoords.y + World::ChunkRadius; chunkZ++)
+				Block block = getBlockInternal(chunk, x, y, z);
+				if (block.calculatedLightLevel() > 1)
 				{
-					for (int chunkX = lastPlayerLoadPosChunkCoords.x - World::ChunkRadius; chunkX <= lastPlayerLoadPosChunkCoords.x + World::ChunkRadius; chunkX++)
-					{
-						const int worldChunkX = chunkX * 16;
-						const int worldChunkZ = chunkZ * 16;
-
-						glm::ivec2 localChunkPos = glm::vec2(lastPlayerLoadPosChunkCoords.x - chunkX, lastPlayerLoadPosChunkCoords.y - chunkZ);
-						bool inRangeOfPlayer =
-							(localChunkPos.x * localChunkPos.x) + (localChunkPos.y * localChunkPos.y) <=
-							((World::ChunkRadius - 1) * (World::ChunkRadius - 1));
-						if (!inRangeOfPlayer)
-						{
-							// Skip over all chunks in range radius - 1
-							continue;
-						}
+					blocksToUpdate.push({ x, y, z });
+				}
+				if (block.calculatedSkyLightLevel() > 1)
+				{
+					skyBlocksToUpdate.push({ x, y, z });
+				}
+			};
 
-						Chunk* chunk = ChunkManager::getChunk(glm::vec3(worldChunkX, 128.0f, worldChunkZ));
-						if (!chunk)
-						{
-							// TODO: Is this a problem...? It should only effect chunks on the edge of the border
-							// g_logger_error("Bad chunk when generating terrain. Skipping chunk.");
-							continue;
-						}
+			for (int y = 0; y < World::ChunkHeight; y++)
+			{
+				for (int i = 0; i < World::ChunkWidth; i++)
+				{
+					addBorderBlock(0, y, i);
+					addBorderBlock(World::ChunkDepth - 1, y, i);
+					if (chunk->bottomNeighbor)
+					{
+						addBorderBlock(-1, y, i);
+					}
+					if (chunk->topNeighbor)
+					{
+						addBorderBlock(World::ChunkDepth, y, i);
+					}
+				}
 
-						if (!chunk->needsToCalculateLighting)
-						{
-							continue;
-						}
+				for (int i = 1; i < World::ChunkDepth - 1; i++)
+				{
+					addBorderBlock(i, y, 0);
+					addBorderBlock(i, y, World::ChunkWidth - 1);
+				}
 
-						if (i == 0)
-						{
-							// First iteration calculate all sky light levels
-							calculateChunkSkyBlocks(chunk, glm::ivec2(chunkX, chunkZ));
-						}
-						else if (i == 1)
-						{
-							// Second iteration calculate all sky "sources" and light sources
-							calculateChunkLighting(chunk, glm::ivec2(chunkX, chunkZ));
-							chunk->needsToCalculateLighting = false;
-						}
+				for (int i = 0; i < World::ChunkDepth; i++)
+				{
+					if (chunk->leftNeighbor)
+					{
+						addBorderBlock(i, y, -1);
+					}
+					if (chunk->rightNeighbor)
+					{
+						addBorderBlock(i, y, World::ChunkWidth);
 					}
 				}
 			}
-		}
 
-		static void calculateChunkSkyBlocks(Chunk* chunk, const glm::ivec2& chunkCoordinates)
-		{
+			while (!skyBlocksToUpdate.empty())
+			{
+				calculateNextSkyLevel(chunk, chunk->chunkCoords, chunksToRetesselate, skyBlocksToUpdate);
+			}
+
+			while (!blocksToUpdate.empty())
+			{
+				calculateNextLightLevel(chunk, chunk->chunkCoords, chunksToRetesselate, blocksToUpdate);
+			}
+		}
+
+		// Returns the lowest section that was filled with sky in one go, or NumSections if there wasn't one
+		static int calculateChunkSkyBlocks(Chunk* chunk, const glm::ivec2& chunkCoordinates)
+		{
+			const int16 skyLightColor =
+				((7 << 0) & 0x7) |  // R
+				((7 << 3) & 0x38) | // G
+				((7 << 6) & 0x1C0); // B
+
+			// Uniform see-through sections at the top of the chunk are sky all the way through, so only
+			// the columns below them need to be walked
+			int firstSkySection = ChunkData::NumSections;
+			uint16 uniformId;
+			while (firstSkySection > 0 &&
+				chunk->data->isSectionUniform(firstSkySection - 1, uniformId) &&
+				BlockMap::hasProperty(uniformId, BlockProperty::Transparent))
+			{
+				firstSkySection--;
+				chunk->data->fillSectionSkyLight(firstSkySection, 31, skyLightColor);
+			}
+
 			for (int x = 0; x < World::ChunkDepth; x++)
 			{
 				for (int z = 0; z < World::ChunkWidth; z++)
 				{
-					for (int y = World::ChunkHeight - 1; y >= 0; y--)
+					for (int y = firstSkySection * ChunkData::SectionHeight - 1; y >= 0; y--)
 					{
 						int arrayExpansion = to1DArray(x, y, z);
-						if (!chunk->data[arrayExpansion].isTransparent())
+						if (!BlockMap::hasProperty(chunk->data->getId(arrayExpansion), BlockProperty::Transparent))
 						{
 							// We're done propagating here
 							break;
 						}
 
 						// Set the block to the max light level since this has to be a sky block
-						chunk->data[arrayExpansion].setSkyLightLevel(31);
-						chunk->data[arrayExpansion].lightColor =
-							((7 << 0) & 0x7) |  // R
-							((7 << 3) & 0x38) | // G
-							((7 << 6) & 0x1C0); // B
+						chunk->data->setSkyLightLevel(arrayExpansion, 31);
+						chunk->data->setLightColor(arrayExpansion, skyLightColor);
 					}
 				}
 			}
+
+			return firstSkySection;
 		}
 
-		static void calculateChunkLighting(Chunk* chunk, const glm::ivec2& chunkCoordinates)
+		static void calculateChunkLighting(Chunk* chunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate, int firstSkySection, const ChunkSnapshot& snapshot)
 		{
 			// Propagate any sky blocks that are acting like "sources"
 			bool anySkySources = false;
 			std::queue<glm::ivec3> skyBlocksToUpdate = {};
 			for (int y = World::ChunkHeight - 1; y >= 0; y--)
 			{
-				for (int x = 0; x < World::ChunkDepth; x++)
+				int sectionIndex = y / ChunkData::SectionHeight;
+				uint16 uniformId;
+				bool uniformSection = snapshot.isSectionUniform(sectionIndex, uniformId);
+				// Nothing in a solid section can be a sky source
+				bool solidSection = uniformSection && !BlockMap::hasProperty(uniformId, BlockProperty::Transparent);
+				// Every block in a section that was filled with sky is a sky block, so only the ones on the
+				// edge of the chunk can have a neighbor that isn't
+				bool skySection = sectionIndex >= firstSkySection;
+				for (int x = 0; x < World::ChunkDepth && !solidSection; x++)
 				{
 					for (int z = 0; z < World::ChunkWidth; z++)
 					{
-						int arrayExpansion = to1DArray(x, y, z);
-						if (!chunk->data[arrayExpansion].isTransparent())
+						if (skySection && x > 0 && x < World::ChunkDepth - 1 && z > 0 && z < World::ChunkWidth - 1)
 						{
 							continue;
 						}
 
-						if (chunk->data[arrayExpansion].calculatedSkyLightLevel() == 31)
+						const Block& currentBlock = snapshot.get(x, y, z);
+						if (!BlockMap::hasProperty(currentBlock.id, BlockProperty::Transparent))
+						{
+							continue;
+						}
+
+						if (currentBlock.calculatedSkyLightLevel() == 31)
 						{
 							anySkySources = true;
 
@@ -1543,7 +2988,7 @@ namespace Minecraft
 								if (INormals3::CardinalDirections[i].y == 0)
 								{
 									glm::ivec3 blockLocalPos = glm::ivec3(x, y, z) + INormals3::CardinalDirections[i];
-									Block block = getBlockInternal(chunk, blockLocalPos.x, blockLocalPos.y, blockLocalPos.z);
+									const Block& block = snapshot.get(blockLocalPos.x, blockLocalPos.y, blockLocalPos.z);
 									if (block.calculatedSkyLightLevel() != 31 && block.isTransparent())
 									{
 										skyBlocksToUpdate.push({ x, y, z });
@@ -1562,45 +3007,53 @@ namespace Minecraft
 					break;
 				}
 			}
-			robin_hood::unordered_flat_set<Chunk*> skyChunksToRetesselate = {};
 			while (!skyBlocksToUpdate.empty())
 			{
-				calculateNextSkyLevel(chunk, chunkCoordinates, skyChunksToRetesselate, skyBlocksToUpdate);
+				calculateNextSkyLevel(chunk, chunkCoordinates, chunksToRetesselate, skyBlocksToUpdate);
 			}
 
 			// Then calculate all light sources
 			std::queue<glm::ivec3> blocksToUpdate = {};
 			for (int y = 0; y < World::ChunkHeight; y++)
 			{
+				uint16 uniformId;
+				if (y % ChunkData::SectionHeight == 0 &&
+					snapshot.isSectionUniform(y / ChunkData::SectionHeight, uniformId) &&
+					!BlockMap::hasProperty(uniformId, BlockProperty::LightSource))
+				{
+					// No light sources anywhere in this section
+					y += ChunkData::SectionHeight - 1;
+					continue;
+				}
+
 				for (int x = 0; x < World::ChunkDepth; x++)
 				{
 					for (int z = 0; z < World::ChunkWidth; z++)
 					{
-						int arrayExpansion = to1DArray(x, y, z);
-						if (!chunk->data[arrayExpansion].isLightSource())
+						uint16 blockId = snapshot.get(x, y, z).id;
+						if (!BlockMap::hasProperty(blockId, BlockProperty::LightSource))
 						{
 							continue;
 						}
-						chunk->data[arrayExpansion].lightLevel = BlockMap::getBlock(chunk->data[arrayExpansion].id).lightLevel;
+						chunk->data->setLightLevel(to1DArray(x, y, z), BlockMap::getBlock(blockId).lightLevel);
 						blocksToUpdate.push({ x, y, z });
 					}
 				}
 			}
 
-			robin_hood::unordered_flat_set<Chunk*> chunksToRetesselate = {};
 			while (!blocksToUpdate.empty())
 			{
 				calculateNextLightLevel(chunk, chunkCoordinates, chunksToRetesselate, blocksToUpdate);
 			}
 		}
 
-		void calculateLightingUpdate(Chunk* chunk, const glm::ivec2& chunkCoordinates, const glm::vec3& blockPosition, bool removedLightSource, robin_hood::unordered_flat_set<Chunk*>& chunksToRetesselate)
+		void calculateLightingUpdate(Chunk* chunk, const glm::ivec2& chunkCoordinates, const glm::vec3& blockPosition, bool removedLightSource, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate)
 		{
 			glm::ivec3 localPosition = glm::floor(blockPosition - glm::vec3(chunkCoordinates.x * 16.0f, 0.0f, chunkCoordinates.y * 16.0f));
 			int localX = localPosition.x;
 			int localY = localPosition.y;
 			int localZ = localPosition.z;
-			Block blockThatsUpdating = chunk->data[to1DArray(localX, localY, localZ)];
+			Block blockThatsUpdating = chunk->data->getBlock(to1DArray(localX, localY, localZ));
 			if (!blockThatsUpdating.isTransparent() && !blockThatsUpdating.isLightSource() && !removedLightSource)
 			{
 				// Just placed a solid block
@@ -1660,7 +3113,7 @@ namespace Minecraft
 				std::queue<glm::ivec3> blocksToUpdate = {};
 				blocksToUpdate.push({ localX, localY, localZ });
 				int arrayExpansion = to1DArray(localX, localY, localZ);
-				chunk->data[arrayExpansion].setLightLevel(BlockMap::getBlock(chunk->data[arrayExpansion].id).lightLevel);
+				chunk->data->setLightLevel(arrayExpansion, BlockMap::getBlock(chunk->data->getId(arrayExpansion)).lightLevel);
 				while (!blocksToUpdate.empty())
 				{
 					calculateNextLightLevel(chunk, chunkCoordinates, chunksToRetesselate, blocksToUpdate);
@@ -1694,13 +3147,13 @@ namespace Minecraft
 						mySkyLevel = 31;
 					}
 				}
-				chunk->data[arrayExpansion].setLightLevel(myLightLevel);
+				chunk->data->setLightLevel(arrayExpansion, myLightLevel);
 				while (!blocksToUpdate.empty())
 				{
 					calculateNextLightLevel(chunk, chunkCoordinates, chunksToRetesselate, blocksToUpdate);
 				}
 
-				chunk->data[arrayExpansion].setSkyLightLevel(mySkyLevel);
+				chunk->data->setSkyLightLevel(arrayExpansion, mySkyLevel);
 				blocksToUpdate.push({ localX, localY, localZ });
 				// If I was a sky block, set all transparent blocks below me to sky blocks
 				if (mySkyLevel == 31)
@@ -1708,13 +3161,13 @@ namespace Minecraft
 					for (int y = localY; y >= 0; y--)
 					{
 						int otherBlockArrayExpansion = to1DArray(localX, y, localZ);
-						Block otherBlock = chunk->data[otherBlockArrayExpansion];
+						Block otherBlock = chunk->data->getBlock(otherBlockArrayExpansion);
 						if (!otherBlock.isTransparent())
 						{
 							break;
 						}
 
-						chunk->data[arrayExpansion].setSkyLightLevel(31);
+						chunk->data->setSkyLightLevel(arrayExpansion, 31);
 						blocksToUpdate.push({ localX, y, localZ });
 					}
 				}
@@ -1759,37 +3212,42 @@ namespace Minecraft
 			return removeLocalBlock(localPosition, chunkCoordinates, chunk);
 		}
 
-		static SubChunk* getSubChunk(Pool<SubChunk, World::ChunkCapacity * 16>* subChunks, SubChunk* currentSubChunk, int currentLevel, const glm::ivec2& chunkCoordinates, bool isBlendableSubChunk)
+		// Copies a level's worth of vertices into a new sub-chunk with room for exactly that many
+		static void uploadSubChunk(Pool<SubChunk>* subChunks, std::vector<Vertex>& vertices, int level, const ChunkHandle& chunk, bool isBlendableSubChunk, uint32 meshVersion)
 		{
-			bool needsNewChunk = currentSubChunk == nullptr
-				|| currentSubChunk->subChunkLevel != currentLevel
-				|| currentSubChunk->numVertsUsed + 6 >= World::MaxVertsPerSubChunk;
-
-			if (needsNewChunk && currentSubChunk)
+			if (vertices.empty())
 			{
-				currentSubChunk->state = SubChunkState::UploadVerticesToGpu;
+				return;
 			}
 
-			SubChunk* ret = currentSubChunk;
-			if (needsNewChunk)
+			// Checking empty() first would race with the other workers, so just try to take one
+			SubChunk* subChunk = subChunks->tryGetNewPool();
+			if (!subChunk)
 			{
-				if (!subChunks->empty())
-				{
-					DebugStats::totalChunkRamUsed = DebugStats::totalChunkRamUsed + (World::MaxVertsPerSubChunk * sizeof(Vertex));
+				g_logger_warning("Ran out of sub-chunks.");
+				vertices.clear();
+				return;
+			}
 
-					ret = subChunks->getNewPool();
-					ret->state = SubChunkState::TesselatingVertices;
-					ret->subChunkLevel = currentLevel;
-					ret->chunkCoordinates = chunkCoordinates;
-					ret->isBlendable = isBlendableSubChunk;
-				}
-				else
-				{
-					g_logger_warning("Ran out of sub-chunk vertex room.");
-					ret = nullptr;
-				}
+			if (!ChunkManager::allocateSubChunkVertices(subChunk, (uint32)vertices.size()))
+			{
+				// TODO: Handle running out of memory better than this
+				g_logger_warning("Ran out of sub-chunk vertex room.");
+				subChunks->freePool(subChunk->drawCommandIndex);
+				vertices.clear();
+				return;
 			}
-			return ret;
+
+			subChunk->state = SubChunkState::TesselatingVertices;
+			subChunk->subChunkLevel = level;
+			subChunk->chunkCoordinates = chunk.chunkCoords;
+			subChunk->meshVersion = meshVersion;
+			subChunk->isBlendable = isBlendableSubChunk;
+			g_memory_copyMem(ChunkManager::getSubChunkVertices(subChunk), vertices.data(), vertices.size() * sizeof(Vertex));
+			vertices.clear();
+
+			subChunk->state = SubChunkState::UploadVerticesToGpu;
+			ChunkManager::queueSubChunkEvent({ SubChunkEventType::Uploaded, subChunk->drawCommandIndex, subChunk->meshVersion, chunk });
 		}
 
 		void GetLightVerticesBySide(uint8_t side, glm::ivec3& v0, glm::ivec3& v1, glm::ivec3& v2, glm::ivec3& v3)
@@ -1853,37 +3311,67 @@ namespace Minecraft
 			}
 		}
 
-		void generateRenderData(Pool<SubChunk, World::ChunkCapacity * 16>* subChunks, const Chunk* chunk, const glm::ivec2& chunkCoordinates)
+		void generateRenderData(Pool<SubChunk>* subChunks, const Chunk* chunk, const glm::ivec2& chunkCoordinates, uint32 meshVersion, uint16 levels, ChunkSnapshot& snapshot, MeshScratch& meshScratch)
 		{
 			const int worldChunkX = chunkCoordinates.x * 16;
 			const int worldChunkZ = chunkCoordinates.y * 16;
+			const ChunkHandle chunkHandle = ChunkDirectory::getHandle(chunk);
+			// Every block below looks at up to 96 blocks around it, so copy the chunk and its border once.
+			// Only the rows between the lowest and highest level being meshed are ever read
+			int lowestLevel = findLowestBit(levels);
+			int highestLevel = lowestLevel;
+			while (levels >> (highestLevel + 1))
+			{
+				highestLevel++;
+			}
+			snapshot.copyFrom(chunk, lowestLevel * 16, highestLevel * 16 + 15);
 
-			SubChunk* solidSubChunk = nullptr;
-			SubChunk* blendableSubChunk = nullptr;
+			meshScratch.solidVertices.clear();
+			meshScratch.blendableVertices.clear();
+			// Read once, so a level never gets its faces recorded and then not merged
+			const bool greedyMeshing = Settings::Chunks::greedyMeshing;
 			for (int y = 0; y < World::ChunkHeight; y++)
 			{
 				int currentLevel = y / 16;
+				// Levels that aren't being meshed keep the sub-chunks they already have
+				if (y % 16 == 0 && !(levels & (1 << currentLevel)))
+				{
+					y += 16 - 1;
+					continue;
+				}
+
+				if (y % ChunkData::SectionHeight == 0 && isSectionHidden(snapshot, y / ChunkData::SectionHeight))
+				{
+					y += ChunkData::SectionHeight - 1;
+					continue;
+				}
+
+				if (y % 16 == 0)
+				{
+					buildFaceMasks(snapshot, currentLevel, meshScratch.faceMasks);
+				}
 
 				for (int x = 0; x < World::ChunkDepth; x++)
 				{
-					for (int z = 0; z < World::ChunkWidth; z++)
+					// One bit per block along z for each face that isn't culled, see buildFaceMasks
+					uint32 visibleFaces[6];
+					getVisibleFaces(meshScratch.faceMasks, y - currentLevel * 16, x, visibleFaces);
+					uint32 blocksToMesh = visibleFaces[0] | visibleFaces[1] | visibleFaces[2] | visibleFaces[3] | visibleFaces[4] | visibleFaces[5];
+					while (blocksToMesh)
 					{
-						// 24 Vertices per cube
-						const Block& block = getBlockInternal(chunk, x, y, z);
-						int blockId = block.id;
+						int z = findLowestBit(blocksToMesh) - 1;
+						uint32 zBit = 1u << (z + 1);
+						blocksToMesh &= ~zBit;
 
-						if (block == BlockMap::NULL_BLOCK || block == BlockMap::AIR_BLOCK)
-						{
-							continue;
-						}
+						const Block& block = snapshot.get(x, y, z);
+						int blockId = block.id;
 
 						const BlockFormat& blockFormat = BlockMap::getBlock(blockId);
-						bool currentBlockIsBlendable = blockFormat.isBlendable;
-						bool currentBlockIsTransparent = blockFormat.isTransparent;
-						bool currentBlockIsWater = blockId == 19;
+						bool currentBlockIsBlendable = BlockMap::hasProperty(blockId, BlockProperty::Blendable);
+						bool currentBlockIsTransparent = BlockMap::hasProperty(blockId, BlockProperty::Transparent);
 
 						// TODO: SIMDify this section
-						static glm::ivec3 verts[8];
+						glm::ivec3 verts[8];
 						verts[0] = glm::ivec3(
 							x,
 							y,
@@ -1903,8 +3391,6 @@ namespace Minecraft
 						int yCoords[6] = { y, y, y - 1, y + 1, y, y };
 						int zCoords[6] = { z - 1, z + 1, z, z, z, z };
 
-						Block blocks[6];
-						glm::ivec3 lightColors[6];
 						const TextureFormat* textures[6] = {
 							blockFormat.sideTexture,
 							blockFormat.sideTexture,
@@ -1922,17 +3408,28 @@ namespace Minecraft
 							{7, 6, 2, 3}  // FRONT
 						};
 
-						glm::vec<4, uint8_t, glm::defaultp> smoothLightVertex[6] = {};
+						std::vector<Vertex>& vertices = currentBlockIsBlendable
+							? meshScratch.blendableVertices
+							: meshScratch.solidVertices;
+						// Faces of fully opaque blocks can be merged with their neighbors, see mergeGreedyFaces
+						bool canMergeFaces = greedyMeshing && !currentBlockIsBlendable && !currentBlockIsTransparent;
 
+						// Culling already happened above, so only the light of the faces that are drawn is worked out
 						for (int i = 0; i < 6; i++)
 						{
-							blocks[i] = getBlockInternal(chunk, xCoords[i], yCoords[i], zCoords[i]);
-							lightColors[i] = glm::ivec3(
-								((blocks[i].lightColor & 0x7) >> 0),  // R
-								((blocks[i].lightColor & 0x38) >> 3), // G
-								((blocks[i].lightColor & 0x1C0) >> 6) // B;
+							if (!(visibleFaces[i] & zBit))
+							{
+								continue;
+							}
+
+							const Block& neighbor = snapshot.get(xCoords[i], yCoords[i], zCoords[i]);
+							glm::ivec3 lightColor = glm::ivec3(
+								((neighbor.lightColor & 0x7) >> 0),  // R
+								((neighbor.lightColor & 0x38) >> 3), // G
+								((neighbor.lightColor & 0x1C0) >> 6) // B;
 							);
 
+							glm::vec<4, uint8_t, glm::defaultp> faceLight;
 							for (int v = 0; v < 4; v++)
 							{
 								glm::ivec3 v0 = verts[vertIndices[i][v]];
@@ -1941,10 +3438,10 @@ namespace Minecraft
 								glm::ivec3 v3 = verts[vertIndices[i][v]];
 								GetLightVerticesBySide(i, v0, v1, v2, v3);
 
-								const Block& v0b = getBlockInternal(chunk, v0.x, v0.y, v0.z);
-								const Block& v1b = getBlockInternal(chunk, v1.x, v1.y, v1.z);
-								const Block& v2b = getBlockInternal(chunk, v2.x, v2.y, v2.z);
-								const Block& v3b = getBlockInternal(chunk, v3.x, v3.y, v3.z);
+								const Block& v0b = snapshot.get(v0.x, v0.y, v0.z);
+								const Block& v1b = snapshot.get(v1.x, v1.y, v1.z);
+								const Block& v2b = snapshot.get(v2.x, v2.y, v2.z);
+								const Block& v3b = snapshot.get(v3.x, v3.y, v3.z);
 
 								uint8_t count = 0;
 
@@ -1979,89 +3476,83 @@ namespace Minecraft
 									currentVertexLight /= count;
 								}
 
-								smoothLightVertex[i][v] = currentVertexLight;
+								faceLight[v] = currentVertexLight;
 							}
-						}
-						const BlockFormat* blockFormats[6] = {
-							&BlockMap::getBlock(blocks[0].id),
-							&BlockMap::getBlock(blocks[1].id),
-							&BlockMap::getBlock(blocks[2].id),
-							&BlockMap::getBlock(blocks[3].id),
-							&BlockMap::getBlock(blocks[4].id),
-							&BlockMap::getBlock(blocks[5].id)
-						};
 
-						SubChunk** currentSubChunkPtr = &solidSubChunk;
-						if (currentBlockIsBlendable)
-						{
-							currentSubChunkPtr = &blendableSubChunk;
-						}
+							bool colorByBiome = i == (int)CUBE_FACE::TOP
+								? blockFormat.colorTopByBiome
+								: i == (int)CUBE_FACE::BOTTOM
+								? blockFormat.colorBottomByBiome
+								: blockFormat.colorSideByBiome;
 
-						// Only add the faces that are not culled by other blocks
-						for (int i = 0; i < 6; i++)
-						{
-							if (blocks[i].id && (blockFormats[i]->isTransparent && !currentBlockIsWater) || (blocks[i] == BlockMap::AIR_BLOCK && currentBlockIsWater))
+							// Smooth lighting is baked into the corners, so only evenly lit faces can be merged
+							if (canMergeFaces && faceLight[0] == faceLight[1] && faceLight[0] == faceLight[2] && faceLight[0] == faceLight[3])
 							{
-								*currentSubChunkPtr = getSubChunk(subChunks, *currentSubChunkPtr, currentLevel, chunkCoordinates, currentBlockIsBlendable);
-								SubChunk* currentSubChunk = *currentSubChunkPtr;
-								if (!currentSubChunk)
-								{
-									// TODO: Handle running out of memory better than this
-									break;
-								}
-								bool colorByBiome = i == (int)CUBE_FACE::TOP
-									? blockFormat.colorTopByBiome
-									: i == (int)CUBE_FACE::BOTTOM
-									? blockFormat.colorBottomByBiome
-									: blockFormat.colorSideByBiome;
-								loadBlock(currentSubChunk->data + currentSubChunk->numVertsUsed,
-									verts[vertIndices[i][0]],
-									verts[vertIndices[i][1]],
-									verts[vertIndices[i][2]],
-									verts[vertIndices[i][3]],
-									*textures[i],
-									(CUBE_FACE)i,
-									colorByBiome,
-									smoothLightVertex[i][0],
-									smoothLightVertex[i][1],
-									smoothLightVertex[i][2],
-									smoothLightVertex[i][3],
-									lightColors[i],
-									blocks[i].calculatedSkyLightLevel());
-								currentSubChunk->numVertsUsed += 6;
+								int faceIndex = (i * 16 + (y % 16)) * World::ChunkWidth * World::ChunkDepth + x * World::ChunkWidth + z;
+								meshScratch.greedyFaces[faceIndex] = packGreedyFace(textures[i]->id, colorByBiome, faceLight[0], neighbor.lightColor, neighbor.calculatedSkyLightLevel());
+								continue;
 							}
+
+							size_t firstVertex = vertices.size();
+							vertices.resize(firstVertex + 6);
+							loadBlock(vertices.data() + firstVertex,
+								verts[vertIndices[i][0]],
+								verts[vertIndices[i][1]],
+								verts[vertIndices[i][2]],
+								verts[vertIndices[i][3]],
+								textures[i]->id,
+								(CUBE_FACE)i,
+								colorByBiome,
+								faceLight[0],
+								faceLight[1],
+								faceLight[2],
+								faceLight[3],
+								lightColor,
+								neighbor.calculatedSkyLightLevel());
 						}
 					}
 				}
-			}
-
-			if (solidSubChunk && solidSubChunk->numVertsUsed > 0)
-			{
-				solidSubChunk->state = SubChunkState::UploadVerticesToGpu;
-			}
-
-			if (blendableSubChunk && blendableSubChunk->numVertsUsed > 0)
-			{
-				blendableSubChunk->state = SubChunkState::UploadVerticesToGpu;
-			}
 
-			for (int i = 0; i < (int)(*subChunks).size(); i++)
-			{
-				if ((*subChunks)[i]->chunkCoordinates == chunkCoordinates && (*subChunks)[i]->state == SubChunkState::RetesselateVertices)
+				// Each level gets its own sub-chunks, so they can be culled separately
+				if ((y + 1) % 16 == 0)
 				{
-					SubChunk* subChunkToUnload = (*subChunks)[i];
-					subChunkToUnload->state = SubChunkState::DoneRetesselating;
+					if (greedyMeshing)
+					{
+						mergeGreedyFaces(meshScratch.solidVertices, meshScratch.greedyFaces.data(), currentLevel);
+					}
+					uploadSubChunk(subChunks, meshScratch.solidVertices, currentLevel, chunkHandle, false, meshVersion);
+					uploadSubChunk(subChunks, meshScratch.blendableVertices, currentLevel, chunkHandle, true, meshVersion);
 				}
 			}
+
+			// Swap out the old mesh now that the new one is complete
+			ChunkManager::queueSubChunkEvent({ SubChunkEventType::MeshFinished, 0, meshVersion, chunkHandle, levels });
 		}
 
-		void serialize(const std::string& worldSavePath, const Block* blockData, const glm::ivec2& chunkCoordinates)
+		void serialize(const std::string& worldSavePath, const Block* blockData, uint16 uniformSections, const glm::ivec2& chunkCoordinates)
 		{
 			if ((Network::isNetworkEnabled() && Network::isLanServer()) || (!Network::isNetworkEnabled()))
 			{
 				std::string filepath = getFormattedFilepath(chunkCoordinates, worldSavePath);
 				FILE* fp = fopen(filepath.c_str(), "wb");
-				fwrite(blockData, sizeof(Block) * World::ChunkWidth * World::ChunkHeight * World::ChunkDepth, 1, fp);
+				fwrite(&CHUNK_FILE_MAGIC, sizeof(uint32), 1, fp);
+				fwrite(&CHUNK_FILE_VERSION, sizeof(uint32), 1, fp);
+				for (int sectionIndex = 0; sectionIndex < ChunkData::NumSections; sectionIndex++)
+				{
+					// Light levels and colors get recalculated on load anyways, so only the id matters
+					const Block* sectionBlocks = blockData + sectionIndex * ChunkData::BlocksPerSection;
+					if (uniformSections & (1 << sectionIndex))
+					{
+						fwrite(&SECTION_UNIFORM, sizeof(uint8), 1, fp);
+						fwrite(&sectionBlocks[0].id, sizeof(uint16), 1, fp);
+						fwrite(&sectionBlocks[0].lightColor, sizeof(int16), 1, fp);
+					}
+					else
+					{
+						fwrite(&SECTION_RAW, sizeof(uint8), 1, fp);
+						fwrite(sectionBlocks, sizeof(Block) * ChunkData::BlocksPerSection, 1, fp);
+					}
+				}
 				fclose(fp);
 			}
 			else
@@ -2070,7 +3561,7 @@ namespace Minecraft
 			}
 		}
 
-		void deserialize(Block* blockData, const std::string& worldSavePath, const glm::ivec2& chunkCoordinates)
+		bool deserialize(ChunkData* chunkData, const std::string& worldSavePath, const glm::ivec2& chunkCoordinates)
 		{
 			if (!Network::isNetworkEnabled())
 			{
@@ -2079,27 +3570,95 @@ namespace Minecraft
 				if (!fp)
 				{
 					g_logger_error("Could not open file '%s'", filepath.c_str());
-					return;
+					return false;
 				}
 
-				fread(blockData, sizeof(Block) * World::ChunkWidth * World::ChunkHeight * World::ChunkDepth, 1, fp);
-				// TODO: Separate lightmaps into different arrays than block ids
-				for (int y = 0; y < World::ChunkHeight; y++)
+				const size_t legacyFileSize = sizeof(Block) * World::ChunkWidth * World::ChunkHeight * World::ChunkDepth;
+				fseek(fp, 0, SEEK_END);
+				size_t fileSize = (size_t)ftell(fp);
+				fseek(fp, 0, SEEK_SET);
+
+				bool readAll = true;
+				if (fileSize == legacyFileSize)
+				{
+					Block* blockData = (Block*)g_memory_allocate(legacyFileSize);
+					readAll = fread(blockData, legacyFileSize, 1, fp) == 1;
+					if (readAll)
+					{
+						chunkData->copyFrom(blockData);
+					}
+					g_memory_free(blockData);
+				}
+				else
 				{
-					for (int x = 0; x < World::ChunkDepth; x++)
+					uint32 magic = 0;
+					uint32 version = 0;
+					readAll = fread(&magic, sizeof(uint32), 1, fp) == 1 &&
+						fread(&version, sizeof(uint32), 1, fp) == 1;
+					if (readAll && (magic != CHUNK_FILE_MAGIC || version != CHUNK_FILE_VERSION))
+					{
+						g_logger_error("Chunk file '%s' is corrupt or from a newer version.", filepath.c_str());
+						fclose(fp);
+						chunkData->clear();
+						return false;
+					}
+
+					chunkData->clear();
+					Block* sectionBlocks = (Block*)g_memory_allocate(sizeof(Block) * ChunkData::BlocksPerSection);
+					for (int sectionIndex = 0; readAll && sectionIndex < ChunkData::NumSections; sectionIndex++)
 					{
-						for (int z = 0; z < World::ChunkWidth; z++)
+						uint8 encoding = SECTION_UNIFORM;
+						readAll = fread(&encoding, sizeof(uint8), 1, fp) == 1;
+						if (!readAll)
+						{
+							break;
+						}
+
+						if (encoding == SECTION_UNIFORM)
+						{
+							uint16 id = 0;
+							int16 lightColor = 0;
+							readAll = fread(&id, sizeof(uint16), 1, fp) == 1 &&
+								fread(&lightColor, sizeof(int16), 1, fp) == 1;
+							if (readAll)
+							{
+								chunkData->fillSection(sectionIndex, id, lightColor);
+							}
+						}
+						else if (encoding == SECTION_RAW)
+						{
+							readAll = fread(sectionBlocks, sizeof(Block) * ChunkData::BlocksPerSection, 1, fp) == 1;
+							if (readAll)
+							{
+								chunkData->copySectionFrom(sectionIndex, sectionBlocks);
+							}
+						}
+						else
 						{
-							blockData[to1DArray(x, y, z)].setLightLevel(0);
-							blockData[to1DArray(x, y, z)].setSkyLightLevel(0);
+							readAll = false;
 						}
 					}
+					g_memory_free(sectionBlocks);
 				}
 				fclose(fp);
+
+				if (!readAll)
+				{
+					g_logger_error("Chunk file '%s' is truncated or corrupt, the chunk will be generated again.", filepath.c_str());
+					chunkData->clear();
+					return false;
+				}
+
+				// Light gets recalculated once the chunk's neighbors are loaded
+				chunkData->clearLight();
+				// What's on disk is what we just loaded
+				chunkData->clearModified();
+				return true;
 			}
 			else
 			{
 				g_logger_warning("Cannot deserialize chunk over the network yet...");
+				return false;
 			}
 		}
 
@@ -2150,7 +3709,152 @@ namespace Minecraft
 			}
 
 			int index = to1DArray(x, y, z);
-			return chunk->data[index];
+			return chunk->data->getBlock(index);
+		}
+
+		static void buildFaceMasks(const ChunkSnapshot& snapshot, int level, FaceMasks& masks)
+		{
+			for (int row = 0; row < FaceMasks::Rows; row++)
+			{
+				int y = level * 16 + row - 1;
+				for (int column = 0; column < FaceMasks::Columns; column++)
+				{
+					int x = column - 1;
+					uint32 drawn = 0;
+					uint32 water = 0;
+					uint32 seeThrough = 0;
+					uint32 air = 0;
+					for (int z = -1; z <= World::ChunkWidth; z++)
+					{
+						uint16 id = snapshot.get(x, y, z).id;
+						if (id == BlockMap::NULL_BLOCK.id)
+						{
+							continue;
+						}
+
+						uint32 bit = 1u << (z + 1);
+						if (id == BlockMap::AIR_BLOCK.id)
+						{
+							air |= bit;
+						}
+						else
+						{
+							drawn |= bit;
+						}
+
+						if (id == 19)
+						{
+							water |= bit;
+						}
+
+						if (BlockMap::hasProperty(id, BlockProperty::Transparent))
+						{
+							seeThrough |= bit;
+						}
+					}
+
+					masks.drawn[row][column] = drawn;
+					masks.water[row][column] = water;
+					masks.seeThrough[row][column] = seeThrough;
+					masks.air[row][column] = air;
+				}
+			}
+		}
+
+		// Same face culling rule as isSectionHidden, for a whole row of blocks at once. Each face gets one bit
+		// per block along z, in the same layout as FaceMasks, set where that face has to be drawn
+		static void getVisibleFaces(const FaceMasks& masks, int localY, int x, uint32 outVisibleFaces[6])
+		{
+			const int row = localY + 1;
+			const int column = x + 1;
+			const uint32 drawn = masks.drawn[row][column];
+			const uint32 water = masks.water[row][column];
+
+			// The neighbors in the order of CUBE_FACE. Along z the neighbor of each block is in the same row,
+			// one bit over
+			const int neighborRows[6] = { row, row, row - 1, row + 1, row, row };
+			const int neighborColumns[6] = { column, column, column, column, column - 1, column + 1 };
+			for (int i = 0; i < 6; i++)
+			{
+				uint32 seeThrough = masks.seeThrough[neighborRows[i]][neighborColumns[i]];
+				uint32 air = masks.air[neighborRows[i]][neighborColumns[i]];
+				if (i == (int)CUBE_FACE::LEFT)
+				{
+					seeThrough <<= 1;
+					air <<= 1;
+				}
+				else if (i == (int)CUBE_FACE::RIGHT)
+				{
+					seeThrough >>= 1;
+					air >>= 1;
+				}
+
+				outVisibleFaces[i] = drawn & ((~water & seeThrough) | (water & air)) & FaceMasks::InsideBits;
+			}
+		}
+
+		static int findLowestBit(uint32 value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, value);
+			return (int)index;
+#else
+			return __builtin_ctz(value);
+#endif
+		}
+
+		// True when a section can't have a single visible face, because it's all air or because it's one
+		// block that every face of is culled by the blocks just outside of it
+		static bool isSectionHidden(const ChunkSnapshot& snapshot, int sectionIndex)
+		{
+			uint16 sectionId;
+			if (!snapshot.isSectionUniform(sectionIndex, sectionId))
+			{
+				return false;
+			}
+
+			if (sectionId == BlockMap::NULL_BLOCK.id || sectionId == BlockMap::AIR_BLOCK.id)
+			{
+				return true;
+			}
+
+			// Same face culling rule as generateRenderData
+			bool sectionIsWater = sectionId == 19;
+			auto isFaceCulled = [sectionIsWater](uint16 neighborId)
+			{
+				bool visible = (neighborId && BlockMap::hasProperty(neighborId, BlockProperty::Transparent) && !sectionIsWater) ||
+					(neighborId == BlockMap::AIR_BLOCK.id && sectionIsWater);
+				return !visible;
+			};
+
+			// Faces between blocks inside the section
+			if (!isFaceCulled(sectionId))
+			{
+				return false;
+			}
+
+			// The six 16x16 layers of blocks touching the section. Anything outside the world or in a chunk
+			// that isn't loaded is already a null block in the snapshot
+			const int minY = sectionIndex * ChunkData::SectionHeight;
+			const int maxY = minY + ChunkData::SectionHeight - 1;
+			for (int a = 0; a < ChunkData::SectionHeight; a++)
+			{
+				for (int b = 0; b < World::ChunkWidth; b++)
+				{
+					if (!isFaceCulled(snapshot.get(-1, minY + a, b).id) ||
+						!isFaceCulled(snapshot.get(World::ChunkDepth, minY + a, b).id) ||
+						!isFaceCulled(snapshot.get(b, minY + a, -1).id) ||
+						!isFaceCulled(snapshot.get(b, minY + a, World::ChunkWidth).id) ||
+						!isFaceCulled(snapshot.get(a, minY - 1, b).id) ||
+						!isFaceCulled(snapshot.get(a, maxY + 1, b).id))
+					{
+						return false;
+					}
+				}
+			}
+
+			return true;
 		}
 
 		static bool setBlockInternal(Chunk* chunk, int x, int y, int z, Block newBlock)
@@ -2186,7 +3890,7 @@ namespace Minecraft
 			}
 
 			int index = to1DArray(x, y, z);
-			chunk->data[index].id = newBlock.id;
+			chunk->data->setId(index, newBlock.id);
 
 			return true;
 		}
@@ -2224,15 +3928,23 @@ namespace Minecraft
 			}
 
 			int index = to1DArray(x, y, z);
-			chunk->data[index].id = BlockMap::AIR_BLOCK.id;
-			chunk->data[index].lightColor =
+			chunk->data->setId(index, BlockMap::AIR_BLOCK.id);
+			chunk->data->setLightColor(index,
 				((7 << 0) & 0x7) | // R
 				((7 << 3) & 0x38) | // G
-				((7 << 6) & 0x1C0); // B
+				((7 << 6) & 0x1C0)); // B
 
 			return true;
 		}
 
+		// Lighting commands only lock the chunks right around their own, so light floods stop at the edge
+		// of those. Positions are relative to the chunk the flood started from
+		static bool isInLockedNeighborhood(int x, int z)
+		{
+			return x >= -World::ChunkDepth && x < World::ChunkDepth * 2 &&
+				z >= -World::ChunkWidth && z < World::ChunkWidth * 2;
+		}
+
 		static bool checkPositionInBounds(Chunk** currentChunk, int* x, int y, int* z)
 		{
 			if (y < 0 || y >= World::ChunkHeight)
@@ -2281,7 +3993,7 @@ namespace Minecraft
 			return true;
 		}
 
-		static void calculateNextLightLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_set<Chunk*>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck)
+		static void calculateNextLightLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck)
 		{
 			glm::ivec3 blockToUpdate = blocksToCheck.front();
 			blocksToCheck.pop();
@@ -2303,22 +4015,26 @@ namespace Minecraft
 					g_logger_warning("Position totally out of bounds...");
 					return;
 				}
-				chunksToRetesselate.insert(blockToUpdateChunk);
+				chunksToRetesselate[blockToUpdateChunk] |= getLevelsTouching(blockToUpdateY);
 			}
 
 			int arrayExpansion = to1DArray(blockToUpdateX, blockToUpdateY, blockToUpdateZ);
-			if (!blockToUpdateChunk->data[arrayExpansion].isTransparent() &&
-				!blockToUpdateChunk->data[arrayExpansion].isLightSource())
+			if (!BlockMap::hasProperty(blockToUpdateChunk->data->getId(arrayExpansion), BlockProperty::Transparent) &&
+				!BlockMap::hasProperty(blockToUpdateChunk->data->getId(arrayExpansion), BlockProperty::LightSource))
 			{
 				return;
 			}
 
-			int myLightLevel = blockToUpdateChunk->data[arrayExpansion].calculatedLightLevel();
+			int myLightLevel = blockToUpdateChunk->data->calculatedLightLevel(arrayExpansion);
 			if (myLightLevel > 0)
 			{
 				for (int i = 0; i < INormals3::CardinalDirections.size(); i++)
 				{
 					const glm::ivec3& iNormal = INormals3::CardinalDirections[i];
+					if (!isInLockedNeighborhood(blockToUpdate.x + iNormal.x, blockToUpdate.z + iNormal.z))
+					{
+						continue;
+					}
 					const glm::ivec3 pos = glm::ivec3(blockToUpdateX + iNormal.x, blockToUpdateY + iNormal.y, blockToUpdateZ + iNormal.z);
 					Block neighbor = getBlockInternal(blockToUpdateChunk, pos.x, pos.y, pos.z);
 					int neighborLight = neighbor.calculatedLightLevel();
@@ -2329,16 +4045,16 @@ namespace Minecraft
 						int neighborLocalZ = pos.z;
 						if (checkPositionInBounds(&neighborChunk, &neighborLocalX, pos.y, &neighborLocalZ))
 						{
-							neighborChunk->data[to1DArray(neighborLocalX, pos.y, neighborLocalZ)].setLightLevel(myLightLevel - 1);
+							neighborChunk->data->setLightLevel(to1DArray(neighborLocalX, pos.y, neighborLocalZ), myLightLevel - 1);
 							blocksToCheck.push(glm::ivec3(blockToUpdate.x + iNormal.x, blockToUpdate.y + iNormal.y, blockToUpdate.z + iNormal.z));
-							chunksToRetesselate.insert(neighborChunk);
+							chunksToRetesselate[neighborChunk] |= getLevelsTouching(pos.y);
 						}
 					}
 				}
 			}
 		}
 
-		static void removeNextLightLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_set<Chunk*>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck, std::queue<glm::ivec3>& lightSources, bool ignoreThisSolidBlock)
+		static void removeNextLightLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck, std::queue<glm::ivec3>& lightSources, bool ignoreThisSolidBlock)
 		{
 			glm::ivec3 blockToUpdate = blocksToCheck.front();
 			blocksToCheck.pop();
@@ -2360,22 +4076,26 @@ namespace Minecraft
 					g_logger_warning("Position totally out of bounds...");
 					return;
 				}
-				chunksToRetesselate.insert(blockToUpdateChunk);
+				chunksToRetesselate[blockToUpdateChunk] |= getLevelsTouching(blockToUpdateY);
 			}
 
 			int arrayExpansion = to1DArray(blockToUpdateX, blockToUpdateY, blockToUpdateZ);
 			if (!ignoreThisSolidBlock &&
-				!blockToUpdateChunk->data[arrayExpansion].isTransparent() &&
-				!blockToUpdateChunk->data[arrayExpansion].isLightSource())
+				!BlockMap::hasProperty(blockToUpdateChunk->data->getId(arrayExpansion), BlockProperty::Transparent) &&
+				!BlockMap::hasProperty(blockToUpdateChunk->data->getId(arrayExpansion), BlockProperty::LightSource))
 			{
 				return;
 			}
 
-			int myOldLightLevel = blockToUpdateChunk->data[arrayExpansion].calculatedLightLevel();
-			blockToUpdateChunk->data[arrayExpansion].setLightLevel(0);
+			int myOldLightLevel = blockToUpdateChunk->data->calculatedLightLevel(arrayExpansion);
+			blockToUpdateChunk->data->setLightLevel(arrayExpansion, 0);
 			for (int i = 0; i < INormals3::CardinalDirections.size(); i++)
 			{
 				const glm::ivec3& iNormal = INormals3::CardinalDirections[i];
+				if (!isInLockedNeighborhood(blockToUpdate.x + iNormal.x, blockToUpdate.z + iNormal.z))
+				{
+					continue;
+				}
 				const glm::ivec3 pos = glm::ivec3(blockToUpdateX + iNormal.x, blockToUpdateY + iNormal.y, blockToUpdateZ + iNormal.z);
 				Block neighbor = getBlockInternal(blockToUpdateChunk, pos.x, pos.y, pos.z);
 				int neighborLight = neighbor.calculatedLightLevel();
@@ -2387,7 +4107,7 @@ namespace Minecraft
 					if (checkPositionInBounds(&neighborChunk, &neighborLocalX, pos.y, &neighborLocalZ))
 					{
 						blocksToCheck.push(glm::ivec3(blockToUpdate.x + iNormal.x, blockToUpdate.y + iNormal.y, blockToUpdate.z + iNormal.z));
-						chunksToRetesselate.insert(neighborChunk);
+						chunksToRetesselate[neighborChunk] |= getLevelsTouching(pos.y);
 					}
 				}
 				else if (neighborLight > myOldLightLevel)
@@ -2398,14 +4118,14 @@ namespace Minecraft
 					if (checkPositionInBounds(&neighborChunk, &neighborLocalX, pos.y, &neighborLocalZ))
 					{
 						lightSources.push(glm::ivec3(blockToUpdate.x + iNormal.x, blockToUpdate.y + iNormal.y, blockToUpdate.z + iNormal.z));
-						chunksToRetesselate.insert(neighborChunk);
+						chunksToRetesselate[neighborChunk] |= getLevelsTouching(pos.y);
 					}
 				}
 			}
 		}
 
 		// TODO: Think about removing this duplication if it doesn't effect performance
-		static void calculateNextSkyLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_set<Chunk*>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck)
+		static void calculateNextSkyLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck)
 		{
 			glm::ivec3 blockToUpdate = blocksToCheck.front();
 			blocksToCheck.pop();
@@ -2426,21 +4146,25 @@ namespace Minecraft
 				{
 					return;
 				}
-				chunksToRetesselate.insert(blockToUpdateChunk);
+				chunksToRetesselate[blockToUpdateChunk] |= getLevelsTouching(blockToUpdateY);
 			}
 
 			int arrayExpansion = to1DArray(blockToUpdateX, blockToUpdateY, blockToUpdateZ);
-			if (!blockToUpdateChunk->data[arrayExpansion].isTransparent())
+			if (!BlockMap::hasProperty(blockToUpdateChunk->data->getId(arrayExpansion), BlockProperty::Transparent))
 			{
 				return;
 			}
 
-			int myLightLevel = blockToUpdateChunk->data[arrayExpansion].calculatedSkyLightLevel();
+			int myLightLevel = blockToUpdateChunk->data->calculatedSkyLightLevel(arrayExpansion);
 			if (myLightLevel > 0)
 			{
 				for (int i = 0; i < INormals3::CardinalDirections.size(); i++)
 				{
 					const glm::ivec3& iNormal = INormals3::CardinalDirections[i];
+					if (!isInLockedNeighborhood(blockToUpdate.x + iNormal.x, blockToUpdate.z + iNormal.z))
+					{
+						continue;
+					}
 					const glm::ivec3 pos = glm::ivec3(blockToUpdateX + iNormal.x, blockToUpdateY + iNormal.y, blockToUpdateZ + iNormal.z);
 					Block neighbor = getBlockInternal(blockToUpdateChunk, pos.x, pos.y, pos.z);
 					int neighborLight = neighbor.calculatedSkyLightLevel();
@@ -2451,17 +4175,17 @@ namespace Minecraft
 						int neighborLocalZ = pos.z;
 						if (checkPositionInBounds(&neighborChunk, &neighborLocalX, pos.y, &neighborLocalZ))
 						{
-							neighborChunk->data[to1DArray(neighborLocalX, pos.y, neighborLocalZ)].setSkyLightLevel(myLightLevel - 1);
+							neighborChunk->data->setSkyLightLevel(to1DArray(neighborLocalX, pos.y, neighborLocalZ), myLightLevel - 1);
 							blocksToCheck.push(glm::ivec3(blockToUpdate.x + iNormal.x, blockToUpdate.y + iNormal.y, blockToUpdate.z + iNormal.z));
 							//g_logger_assert(iNormal.y != 1, "Sky sources should never propagate up once we get inside of here.");
-							chunksToRetesselate.insert(neighborChunk);
+							chunksToRetesselate[neighborChunk] |= getLevelsTouching(pos.y);
 						}
 					}
 				}
 			}
 		}
 
-		static void removeNextSkyLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_set<Chunk*>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck, std::queue<glm::ivec3>& lightSources, bool ignoreThisSolidBlock)
+		static void removeNextSkyLevel(Chunk* originalChunk, const glm::ivec2& chunkCoordinates, robin_hood::unordered_flat_map<Chunk*, uint16>& chunksToRetesselate, std::queue<glm::ivec3>& blocksToCheck, std::queue<glm::ivec3>& lightSources, bool ignoreThisSolidBlock)
 		{
 			glm::ivec3 blockToUpdate = blocksToCheck.front();
 			blocksToCheck.pop();
@@ -2482,21 +4206,25 @@ namespace Minecraft
 				{
 					return;
 				}
-				chunksToRetesselate.insert(blockToUpdateChunk);
+				chunksToRetesselate[blockToUpdateChunk] |= getLevelsTouching(blockToUpdateY);
 			}
 
 			int arrayExpansion = to1DArray(blockToUpdateX, blockToUpdateY, blockToUpdateZ);
 			if (!ignoreThisSolidBlock &&
-				!blockToUpdateChunk->data[arrayExpansion].isTransparent())
+				!BlockMap::hasProperty(blockToUpdateChunk->data->getId(arrayExpansion), BlockProperty::Transparent))
 			{
 				return;
 			}
 
-			int myOldLightLevel = blockToUpdateChunk->data[arrayExpansion].calculatedSkyLightLevel();
-			blockToUpdateChunk->data[arrayExpansion].setSkyLightLevel(0);
+			int myOldLightLevel = blockToUpdateChunk->data->calculatedSkyLightLevel(arrayExpansion);
+			blockToUpdateChunk->data->setSkyLightLevel(arrayExpansion, 0);
 			for (int i = 0; i < INormals3::CardinalDirections.size(); i++)
 			{
 				const glm::ivec3& iNormal = INormals3::CardinalDirections[i];
+				if (!isInLockedNeighborhood(blockToUpdate.x + iNormal.x, blockToUpdate.z + iNormal.z))
+				{
+					continue;
+				}
 				const glm::ivec3 pos = glm::ivec3(blockToUpdateX + iNormal.x, blockToUpdateY + iNormal.y, blockToUpdateZ + iNormal.z);
 				Block neighbor = getBlockInternal(blockToUpdateChunk, pos.x, pos.y, pos.z);
 				int neighborLight = neighbor.calculatedSkyLightLevel();
@@ -2510,7 +4238,7 @@ namespace Minecraft
 					{
 						blocksToCheck.push(glm::ivec3(blockToUpdate.x + iNormal.x, blockToUpdate.y + iNormal.y, blockToUpdate.z + iNormal.z));
 					}
-					chunksToRetesselate.insert(neighborChunk);
+					chunksToRetesselate[neighborChunk] |= getLevelsTouching(pos.y);
 				}
 				else if (neighborLight > myOldLightLevel)
 				{
@@ -2521,7 +4249,7 @@ namespace Minecraft
 					{
 						lightSources.push(glm::ivec3(blockToUpdate.x + iNormal.x, blockToUpdate.y + iNormal.y, blockToUpdate.z + iNormal.z));
 					}
-					chunksToRetesselate.insert(neighborChunk);
+					chunksToRetesselate[neighborChunk] |= getLevelsTouching(pos.y);
 				}
 			}
 		}
@@ -2546,54 +4274,57 @@ namespace Minecraft
 			};
 		}
 
-		static Vertex compress(
-			const glm::ivec3& vertex,
-			const TextureFormat& texture,
-			CUBE_FACE face,
-			UV_INDEX uvIndex,
-			bool colorVertexBasedOnBiome,
-			int lightLevel,
-			const glm::ivec3& lightColor,
-			int skyLightLevel)
+		// Everything about a face's vertices that doesn't depend on the block it's on, so loadBlock only has to
+		// OR the block's bits on top. The texture corners are already turned the way each face needs them
+		struct FaceVertexTemplate
 		{
-			// Bits  0-16 position index
-			// Bits 17-28 texId
-			// Bits 29-31 normalDir face value
-			uint32 data1 = 0;
-
-			int positionIndex = toCompressedVec3(vertex.x, vertex.y, vertex.z);
-			data1 |= ((positionIndex << 0) & POSITION_INDEX_BITMASK);
-			data1 |= ((texture.id << 17) & TEX_ID_BITMASK);
-			data1 |= ((uint32)face << 29) & FACE_BITMASK;
-
-			uint32 data2 = 0;
-
-			// Bits  0- 1 UV Index -- this tells us which corner to use for the texture coords
-			// Bit      2 Color the block based on biome
-			// Bits  4- 8 Light level
-			// Bits  9-17 Light color
-			// Bits 17-22 Sky Light Level
-			data2 |= (((uint32)uvIndex << 0) & UV_INDEX_BITMASK);
-			data2 |= (((uint32)(colorVertexBasedOnBiome ? 1 : 0) << 2) & COLOR_BLOCK_BIOME_BITMASK);
-			data2 |= (((uint32)(lightLevel << 3) & LIGHT_LEVEL_BITMASK));
-			data2 |= (((uint32)(lightColor.r << 8) & LIGHT_COLOR_BITMASK_R));
-			data2 |= (((uint32)(lightColor.g << 11) & LIGHT_COLOR_BITMASK_G));
-			data2 |= (((uint32)(lightColor.b << 14) & LIGHT_COLOR_BITMASK_B));
-			data2 |= (((uint32)(skyLightLevel << 17) & SKY_LIGHT_LEVEL_BITMASK));
+			// Bits 29-31 of data1
+			uint32 data1;
+			// Bits 0-1 of data2 for each corner of the quad, in the order loadBlock gets the corners in
+			uint32 data2[4];
+			// The UV indices go around the texture in order, so from an even index the next corner is across
+			// the texture's u axis and from an odd one it's across v. When the first corner's index is odd the
+			// quad's size has to be swapped to line up with the texture
+			bool swapsTileExtent;
+		};
 
-			return {
-				data1,
-				data2
+		static FaceVertexTemplate makeFaceVertexTemplate(CUBE_FACE face, int uvRotation)
+		{
+			static const UV_INDEX cornerUvs[4] = {
+				UV_INDEX::BOTTOM_RIGHT,
+				UV_INDEX::TOP_RIGHT,
+				UV_INDEX::TOP_LEFT,
+				UV_INDEX::BOTTOM_LEFT
 			};
+
+			FaceVertexTemplate faceTemplate;
+			faceTemplate.data1 = ((uint32)face << 29) & FACE_BITMASK;
+			for (int corner = 0; corner < 4; corner++)
+			{
+				uint32 uvIndex = ((uint32)cornerUvs[corner] + uvRotation) % (uint32)UV_INDEX::SIZE;
+				faceTemplate.data2[corner] = uvIndex & UV_INDEX_BITMASK;
+			}
+			faceTemplate.swapsTileExtent = faceTemplate.data2[0] % 2 != 0;
+			return faceTemplate;
 		}
 
+		// Indexed by CUBE_FACE
+		static const FaceVertexTemplate FACE_VERTEX_TEMPLATES[(int)CUBE_FACE::SIZE] = {
+			makeFaceVertexTemplate(CUBE_FACE::LEFT, 3),
+			makeFaceVertexTemplate(CUBE_FACE::RIGHT, 3),
+			makeFaceVertexTemplate(CUBE_FACE::BOTTOM, 0),
+			makeFaceVertexTemplate(CUBE_FACE::TOP, 0),
+			makeFaceVertexTemplate(CUBE_FACE::BACK, 2),
+			makeFaceVertexTemplate(CUBE_FACE::FRONT, 0)
+		};
+
 		static void loadBlock(
 			Vertex* vertexData,
 			const glm::ivec3& vert1,
 			const glm::ivec3& vert2,
 			const glm::ivec3& vert3,
 			const glm::ivec3& vert4,
-			const TextureFormat& texture,
+			uint16 textureId,
 			CUBE_FACE face,
 			bool colorFaceBasedOnBiome,
 			uint8_t lightLevelv1,
@@ -2601,51 +4332,215 @@ namespace Minecraft
 			uint8_t lightLevelv3,
 			uint8_t lightLevelv4,
 			const glm::ivec3& lightColor,
-			int skyLightLevel)
+			int skyLightLevel,
+			const glm::ivec2& quadSize)
 		{
-			UV_INDEX uv0 = UV_INDEX::BOTTOM_RIGHT;
-			UV_INDEX uv1 = UV_INDEX::TOP_RIGHT;
-			UV_INDEX uv2 = UV_INDEX::TOP_LEFT;
+			const FaceVertexTemplate& faceTemplate = FACE_VERTEX_TEMPLATES[(int)face];
+			// quadSize is along vert1 -> vert2 and vert1 -> vert4
+			glm::ivec2 tileExtent = faceTemplate.swapsTileExtent
+				? glm::ivec2(quadSize.y, quadSize.x)
+				: quadSize;
 
-			UV_INDEX uv3 = UV_INDEX::BOTTOM_RIGHT;
-			UV_INDEX uv4 = UV_INDEX::TOP_LEFT;
-			UV_INDEX uv5 = UV_INDEX::BOTTOM_LEFT;
+			// Bits  0-16 position index
+			// Bits 17-28 texId
+			// Bits 29-31 normalDir face value
+			const uint32 faceData1 = faceTemplate.data1 | (((uint32)textureId << 17) & TEX_ID_BITMASK);
 
-			switch (face)
+			// Bits  0- 1 UV Index -- this tells us which corner to use for the texture coords
+			// Bit      2 Color the block based on biome
+			// Bits  3- 7 Light level
+			// Bits  8-16 Light color
+			// Bits 17-21 Sky Light Level
+			// Bits 22-25 How many times the texture repeats along u, minus one
+			// Bits 26-29 How many times the texture repeats along v, minus one
+			const uint32 faceData2 =
+				(((uint32)(colorFaceBasedOnBiome ? 1 : 0) << 2) & COLOR_BLOCK_BIOME_BITMASK) |
+				((uint32)(lightColor.r << 8) & LIGHT_COLOR_BITMASK_R) |
+				((uint32)(lightColor.g << 11) & LIGHT_COLOR_BITMASK_G) |
+				((uint32)(lightColor.b << 14) & LIGHT_COLOR_BITMASK_B) |
+				((uint32)(skyLightLevel << 17) & SKY_LIGHT_LEVEL_BITMASK) |
+				(((uint32)(tileExtent.x - 1) << 22) & TILE_EXTENT_U_BITMASK) |
+				(((uint32)(tileExtent.y - 1) << 26) & TILE_EXTENT_V_BITMASK);
+
+			// Only the position and light differ between the 4 corners, and the two triangles share two of them
+			const uint32 positionIndices[4] = {
+				(uint32)toCompressedVec3(vert1.x, vert1.y, vert1.z),
+				(uint32)toCompressedVec3(vert2.x, vert2.y, vert2.z),
+				(uint32)toCompressedVec3(vert3.x, vert3.y, vert3.z),
+				(uint32)toCompressedVec3(vert4.x, vert4.y, vert4.z)
+			};
+			const uint32 lightLevels[4] = { lightLevelv1, lightLevelv2, lightLevelv3, lightLevelv4 };
+			Vertex corners[4];
+			for (int corner = 0; corner < 4; corner++)
 			{
-			case CUBE_FACE::BACK:
-				uv0 = (UV_INDEX)(((int)uv0 + 2) % (int)UV_INDEX::SIZE);
-				uv1 = (UV_INDEX)(((int)uv1 + 2) % (int)UV_INDEX::SIZE);
-				uv2 = (UV_INDEX)(((int)uv2 + 2) % (int)UV_INDEX::SIZE);
-				uv3 = (UV_INDEX)(((int)uv3 + 2) % (int)UV_INDEX::SIZE);
-				uv4 = (UV_INDEX)(((int)uv4 + 2) % (int)UV_INDEX::SIZE);
-				uv5 = (UV_INDEX)(((int)uv5 + 2) % (int)UV_INDEX::SIZE);
-				break;
-			case CUBE_FACE::RIGHT:
-				uv0 = (UV_INDEX)(((int)uv0 + 3) % (int)UV_INDEX::SIZE);
-				uv1 = (UV_INDEX)(((int)uv1 + 3) % (int)UV_INDEX::SIZE);
-				uv2 = (UV_INDEX)(((int)uv2 + 3) % (int)UV_INDEX::SIZE);
-				uv3 = (UV_INDEX)(((int)uv3 + 3) % (int)UV_INDEX::SIZE);
-				uv4 = (UV_INDEX)(((int)uv4 + 3) % (int)UV_INDEX::SIZE);
-				uv5 = (UV_INDEX)(((int)uv5 + 3) % (int)UV_INDEX::SIZE);
-				break;
-			case CUBE_FACE::LEFT:
-				uv0 = (UV_INDEX)(((int)uv0 + 3) % (int)UV_INDEX::SIZE);
-				uv1 = (UV_INDEX)(((int)uv1 + 3) % (int)UV_INDEX::SIZE);
-				uv2 = (UV_INDEX)(((int)uv2 + 3) % (int)UV_INDEX::SIZE);
-				uv3 = (UV_INDEX)(((int)uv3 + 3) % (int)UV_INDEX::SIZE);
-				uv4 = (UV_INDEX)(((int)uv4 + 3) % (int)UV_INDEX::SIZE);
-				uv5 = (UV_INDEX)(((int)uv5 + 3) % (int)UV_INDEX::SIZE);
-				break;
+				corners[corner].data1 = faceData1 | (positionIndices[corner] & POSITION_INDEX_BITMASK);
+				corners[corner].data2 = faceData2 | faceTemplate.data2[corner] | ((lightLevels[corner] << 3) & LIGHT_LEVEL_BITMASK);
 			}
 
-			vertexData[0] = compress(vert1, texture, face, uv0, colorFaceBasedOnBiome, lightLevelv1, lightColor, skyLightLevel);
-			vertexData[1] = compress(vert2, texture, face, uv1, colorFaceBasedOnBiome, lightLevelv2, lightColor, skyLightLevel);
-			vertexData[2] = compress(vert3, texture, face, uv2, colorFaceBasedOnBiome, lightLevelv3, lightColor, skyLightLevel);
+			vertexData[0] = corners[0];
+			vertexData[1] = corners[1];
+			vertexData[2] = corners[2];
+
+			vertexData[3] = corners[0];
+			vertexData[4] = corners[2];
+			vertexData[5] = corners[3];
+		}
+
+		// Everything that has to match for two faces to be merged. Bit 0 is always set so no face packs to zero
+		static uint64 packGreedyFace(uint16 textureId, bool colorFaceBasedOnBiome, uint8 lightLevel, int16 lightColor, int skyLightLevel)
+		{
+			return 1ull
+				| ((uint64)(textureId & 0xFFF) << 1)
+				| ((uint64)(colorFaceBasedOnBiome ? 1 : 0) << 13)
+				| ((uint64)(lightLevel & 0x1F) << 14)
+				| ((uint64)(lightColor & 0x1FF) << 19)
+				| ((uint64)(skyLightLevel & 0x1F) << 28);
+		}
+
+		// Greedy meshing. Each face direction of a level is cut into 16 slices, and every slice is covered by
+		// rectangles of matching faces: grow along the first axis as far as the faces match, then add rows
+		// along the second axis for as long as the whole row matches. Each rectangle becomes one quad with the
+		// texture repeated across it.
+		static void mergeGreedyFaces(std::vector<Vertex>& vertices, uint64* greedyFaces, int level)
+		{
+			static const int LevelSize = World::ChunkWidth * World::ChunkDepth * 16;
+			static const glm::ivec4 vertIndices[6] = {
+				{0, 4, 7, 3}, // LEFT
+				{2, 6, 5, 1}, // RIGHT
+				{0, 3, 2, 1}, // BOTTOM
+				{5, 6, 7, 4}, // TOP
+				{0, 1, 5, 4}, // BACK
+				{7, 6, 2, 3}  // FRONT
+			};
+			// The axis each face points along, and the two axes the slice spans, as x = 0, y = 1, z = 2
+			static const int normalAxes[6] = { 2, 2, 1, 1, 0, 0 };
+			static const int firstAxes[6] = { 0, 0, 0, 0, 2, 2 };
+			static const int secondAxes[6] = { 1, 1, 2, 2, 1, 1 };
+			// Local y inside the level, then x, then z, the same as generateRenderData fills it in
+			auto indexOf = [](const glm::ivec3& pos)
+			{
+				return pos.y * World::ChunkWidth * World::ChunkDepth + pos.x * World::ChunkWidth + pos.z;
+			};
+
+			for (int face = 0; face < 6; face++)
+			{
+				uint64* faces = greedyFaces + face * LevelSize;
+				for (int slice = 0; slice < 16; slice++)
+				{
+					for (int b = 0; b < 16; b++)
+					{
+						for (int a = 0; a < 16;)
+						{
+							glm::ivec3 start;
+							start[normalAxes[face]] = slice;
+							start[firstAxes[face]] = a;
+							start[secondAxes[face]] = b;
+
+							uint64 key = faces[indexOf(start)];
+							if (!key)
+							{
+								a++;
+								continue;
+							}
+
+							int width = 1;
+							glm::ivec3 pos = start;
+							for (pos[firstAxes[face]] = a + 1; pos[firstAxes[face]] < 16 && faces[indexOf(pos)] == key; pos[firstAxes[face]]++)
+							{
+								width++;
+							}
+
+							int height = 1;
+							for (int row = b + 1; row < 16; row++)
+							{
+								pos = start;
+								pos[secondAxes[face]] = row;
+								bool rowMatches = true;
+								for (int i = 0; i < width; i++)
+								{
+									pos[firstAxes[face]] = a + i;
+									if (faces[indexOf(pos)] != key)
+									{
+										rowMatches = false;
+										break;
+									}
+								}
+
+								if (!rowMatches)
+								{
+									break;
+								}
+								height++;
+							}
+
+							// Clear what this quad covers, that also leaves the scratch zeroed for the next level
+							for (int j = 0; j < height; j++)
+							{
+								for (int i = 0; i < width; i++)
+								{
+									pos = start;
+									pos[firstAxes[face]] = a + i;
+									pos[secondAxes[face]] = b + j;
+									faces[indexOf(pos)] = 0;
+								}
+							}
+
+							// Stretch a unit cube over the rectangle and take this face's corners from it, just like a single block
+							glm::ivec3 size = glm::ivec3(1);
+							size[firstAxes[face]] = width;
+							size[secondAxes[face]] = height;
+							glm::ivec3 origin = start + glm::ivec3(0, level * 16, 0);
+							glm::ivec3 verts[8];
+							verts[0] = origin;
+							verts[1] = verts[0] + INormals3::Right * size.z;
+							verts[2] = verts[1] + INormals3::Front * size.x;
+							verts[3] = verts[0] + INormals3::Front * size.x;
+							for (int i = 0; i < 4; i++)
+							{
+								verts[i + 4] = verts[i] + INormals3::Up * size.y;
+							}
+
+							const glm::ivec3& vert1 = verts[vertIndices[face][0]];
+							const glm::ivec3& vert2 = verts[vertIndices[face][1]];
+							const glm::ivec3& vert4 = verts[vertIndices[face][3]];
+							glm::ivec3 edge1 = glm::abs(vert2 - vert1);
+							glm::ivec3 edge2 = glm::abs(vert4 - vert1);
+							glm::ivec2 quadSize = glm::ivec2(edge1.x + edge1.y + edge1.z, edge2.x + edge2.y + edge2.z);
+
+							uint16 textureId = (uint16)((key >> 1) & 0xFFF);
+							bool colorByBiome = (key >> 13) & 1;
+							uint8 lightLevel = (uint8)((key >> 14) & 0x1F);
+							int16 packedLightColor = (int16)((key >> 19) & 0x1FF);
+							int skyLightLevel = (int)((key >> 28) & 0x1F);
+							glm::ivec3 lightColor = glm::ivec3(
+								((packedLightColor & 0x7) >> 0),
+								((packedLightColor & 0x38) >> 3),
+								((packedLightColor & 0x1C0) >> 6)
+							);
 
-			vertexData[3] = compress(vert1, texture, face, uv3, colorFaceBasedOnBiome, lightLevelv1, lightColor, skyLightLevel);
-			vertexData[4] = compress(vert3, texture, face, uv4, colorFaceBasedOnBiome, lightLevelv3, lightColor, skyLightLevel);
-			vertexData[5] = compress(vert4, texture, face, uv5, colorFaceBasedOnBiome, lightLevelv4, lightColor, skyLightLevel);
+							size_t firstVertex = vertices.size();
+							vertices.resize(firstVertex + 6);
+							loadBlock(vertices.data() + firstVertex,
+								vert1,
+								vert2,
+								verts[vertIndices[face][2]],
+								vert4,
+								textureId,
+								(CUBE_FACE)face,
+								colorByBiome,
+								lightLevel,
+								lightLevel,
+								lightLevel,
+								lightLevel,
+								lightColor,
+								skyLightLevel,
+								quadSize);
+
+							a += width;
+						}
+					}
+				}
+			}
 		}
 	}
 }
\ No newline at end of file
@@ -55,6 +55,11 @@ namespace Minecraft
 		static Ecs::Registry* registry;
 		static glm::vec2 lastPlayerLoadPosition;
 		static bool isClient;
+		// Where new players start out
+		static const glm::vec3 spawnPosition = glm::vec3(-145.0f, 289.0f, 55.0f);
+
+		// Internal functions
+		static bool initSaveData();
 
 		void init(Ecs::Registry& sceneRegistry, const char* hostname, int port)
 		{
@@ -65,7 +70,7 @@ namespace Minecraft
 			registry = &sceneRegistry;
 			ChunkManager::init();
 
-			lastPlayerLoadPosition = glm::vec2(-145.0f, 55.0f);
+			lastPlayerLoadPosition = glm::vec2(spawnPosition.x, spawnPosition.z);
 			if (strcmp(hostname, "") != 0 && port != 0)
 			{
 				isClient = true;
@@ -84,9 +89,7 @@ namespace Minecraft
 				boxCollider.size.y = 1.8f;
 				boxCollider.size.z = 0.55f;
 				Transform& playerTransform = registry->getComponent<Transform>(player);
-				playerTransform.position.x = -145.0f;
-				playerTransform.position.y = 289;
-				playerTransform.position.z = 55.0f;
+				playerTransform.position = spawnPosition;
 				CharacterController& controller = registry->getComponent<CharacterController>(player);
 				controller.lockedToCamera = true;
 				controller.controllerBaseSpeed = 4.4f;
@@ -117,9 +120,8 @@ namespace Minecraft
 				boxCollider2.size.y = 1.8f;
 				boxCollider2.size.z = 0.55f;
 				Transform& transform2 = registry->getComponent<Transform>(randomEntity);
+				transform2.position = spawnPosition;
 				transform2.position.y = 255;
-				transform2.position.x = -145.0f;
-				transform2.position.z = 55.0f;
 				CharacterController& controller2 = registry->getComponent<CharacterController>(randomEntity);
 				controller2.lockedToCamera = false;
 				controller2.controllerBaseSpeed = 4.2f;
@@ -140,35 +142,11 @@ namespace Minecraft
 			}
 			else
 			{
-				// Initialize and create any filepaths for save information
-				g_logger_assert(savePath != "", "World save path must not be empty.");
-				savePath = (std::filesystem::path(AppData::worldsRootPath) / std::filesystem::path(savePath)).string();
-				File::createDirIfNotExists(savePath.c_str());
-				chunkSavePath = (savePath / std::filesystem::path("chunks")).string();
-				g_logger_info("World save folder at: %s", savePath.c_str());
-				File::createDirIfNotExists(chunkSavePath.c_str());
-
-				// Generate a seed if needed
-				srand((unsigned long)time(NULL));
-				if (File::isFile(getWorldDataFilepath(savePath).c_str()))
-				{
-					if (!deserialize())
-					{
-						g_logger_error("Could not load world. World.bin has been corrupted or does not exist.");
-						return;
-					}
-				}
-
-				if (seed == UINT32_MAX)
+				if (!initSaveData())
 				{
-					// Generate a seed between -INT32_MAX and INT32_MAX
-					seed = (uint32)(((float)rand() / (float)RAND_MAX) * UINT32_MAX);
+					return;
 				}
-				seedAsFloat = (float)((double)seed / (double)UINT32_MAX) * 2.0f - 1.0f;
-				srand(seed);
 				g_logger_info("Loading world in single player mode locally.");
-				g_logger_info("World seed: %u", seed);
-				g_logger_info("World seed (as float): %2.8f", seedAsFloat.load());
 
 				// TODO: Remove me, just here for testing
 				// ~~ECS can handle large numbers of entities fine~~
@@ -227,9 +205,7 @@ namespace Minecraft
 				boxCollider.size.y = 1.8f;
 				boxCollider.size.z = 0.55f;
 				Transform& playerTransform = registry->getComponent<Transform>(player);
-				playerTransform.position.x = -145.0f;
-				playerTransform.position.y = 289;
-				playerTransform.position.z = 55.0f;
+				playerTransform.position = spawnPosition;
 				CharacterController& controller = registry->getComponent<CharacterController>(player);
 				controller.lockedToCamera = true;
 				controller.controllerBaseSpeed = 4.4f;
@@ -260,9 +236,8 @@ namespace Minecraft
 				boxCollider2.size.y = 1.8f;
 				boxCollider2.size.z = 0.55f;
 				Transform& transform2 = registry->getComponent<Transform>(randomEntity);
+				transform2.position = spawnPosition;
 				transform2.position.y = 255;
-				transform2.position.x = -145.0f;
-				transform2.position.z = 55.0f;
 				CharacterController& controller2 = registry->getComponent<CharacterController>(randomEntity);
 				controller2.lockedToCamera = false;
 				controller2.controllerBaseSpeed = 5.6f;
@@ -299,6 +274,21 @@ namespace Minecraft
 			MainHud::init();
 		}
 
+		void pregenerate(int radius)
+		{
+			isClient = false;
+			if (!initSaveData())
+			{
+				return;
+			}
+
+			g_logger_info("Pregenerating a radius of %d chunks around spawn.", radius);
+			ChunkManager::init(true);
+			ChunkManager::pregenerate(spawnPosition, radius);
+			serialize();
+			ChunkManager::free();
+		}
+
 		void free()
 		{
 			// Force any connections that might have been opened to close
@@ -497,6 +487,39 @@ namespace Minecraft
 			return false;
 		}
 
+		static bool initSaveData()
+		{
+			// Initialize and create any filepaths for save information
+			g_logger_assert(savePath != "", "World save path must not be empty.");
+			savePath = (std::filesystem::path(AppData::worldsRootPath) / std::filesystem::path(savePath)).string();
+			File::createDirIfNotExists(savePath.c_str());
+			chunkSavePath = (savePath / std::filesystem::path("chunks")).string();
+			g_logger_info("World save folder at: %s", savePath.c_str());
+			File::createDirIfNotExists(chunkSavePath.c_str());
+
+			// Generate a seed if needed
+			srand((unsigned long)time(NULL));
+			if (File::isFile(getWorldDataFilepath(savePath).c_str()))
+			{
+				if (!deserialize())
+				{
+					g_logger_error("Could not load world. World.bin has been corrupted or does not exist.");
+					return false;
+				}
+			}
+
+			if (seed == UINT32_MAX)
+			{
+				// Generate a seed between -INT32_MAX and INT32_MAX
+				seed = (uint32)(((float)rand() / (float)RAND_MAX) * UINT32_MAX);
+			}
+			seedAsFloat = (float)((double)seed / (double)UINT32_MAX) * 2.0f - 1.0f;
+			srand(seed);
+			g_logger_info("World seed: %u", seed);
+			g_logger_info("World seed (as float): %2.8f", seedAsFloat.load());
+			return true;
+		}
+
 		glm::ivec2 toChunkCoords(const glm::vec3& worldCoordinates)
 		{
 			return {
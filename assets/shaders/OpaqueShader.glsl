@@ -6,7 +6,11 @@ layout (location = 1) in uint aData2;
 layout (location = 10) in ivec2 aChunkPos;
 layout (location = 11) in int aBiome;
 
-out vec2 fTexCoords;
+out vec2 fTileCoords;
+flat out vec2 fTileExtent;
+flat out vec2 fTexCoordsOrigin;
+flat out vec2 fTexCoordsU;
+flat out vec2 fTexCoordsV;
 flat out uint fFace;
 out vec3 fFragPosition;
 out vec3 fColor;
@@ -28,6 +32,8 @@ uniform mat4 uView;
 #define LIGHT_COLOR_BITMASK_G uint(0x03800)
 #define LIGHT_COLOR_BITMASK_B uint(0x1C000)
 #define SKY_LIGHT_LEVEL_BITMASK uint(0x3E0000)
+#define TILE_EXTENT_U_BITMASK uint(0x3C00000)
+#define TILE_EXTENT_V_BITMASK uint(0x3C000000)
 
 #define BASE_17_WIDTH uint(17)
 #define BASE_17_DEPTH uint(17)
@@ -47,13 +53,34 @@ void extractFace(in uint data, out uint face)
 	face = ((data & FACE_BITMASK) >> 29);
 }
 
-void extractTexCoords(in uint data1, in uint data2, out vec2 texCoords)
+// Greedy meshing merges faces into quads that cover several blocks, so instead of one corner of the texture
+// every vertex gets its position in tiles, and the fragment shader repeats the texture once per tile
+void extractTexCoords(in uint data1, in uint data2, out vec2 tileCoords, out vec2 tileExtent, out vec2 origin, out vec2 uAxis, out vec2 vAxis)
 {
 	uint textureId = ((data1 & TEX_ID_BITMASK) >> 17);
+	int index = int(textureId * uint(8));
+	vec2 corners[4];
+	for (int i = 0; i < 4; i++)
+	{
+		corners[i].x = texelFetch(uTexCoordTexture, index + i * 2 + 0).r;
+		corners[i].y = texelFetch(uTexCoordTexture, index + i * 2 + 1).r;
+	}
+
+	// The corners go around the texture in order
+	origin = corners[2];
+	uAxis = corners[3] - corners[2];
+	vAxis = corners[1] - corners[2];
+
 	uint uvIndex = data2 & UV_INDEX_BITMASK;
-	int index = int((textureId * uint(8)) + (uvIndex * uint(2)));
-	texCoords.x = texelFetch(uTexCoordTexture, index + 0).r;
-	texCoords.y = texelFetch(uTexCoordTexture, index + 1).r;
+	vec2 corner = vec2(
+		(uvIndex == uint(0) || uvIndex == uint(3)) ? 1.0 : 0.0,
+		(uvIndex < uint(2)) ? 1.0 : 0.0
+	);
+	tileExtent = vec2(
+		float(((data2 & TILE_EXTENT_U_BITMASK) >> 22) + uint(1)),
+		float(((data2 & TILE_EXTENT_V_BITMASK) >> 26) + uint(1))
+	);
+	tileCoords = corner * tileExtent;
 }
 
 void extractColorVertexBiome(in uint data2, out bool colorVertexBiome)
@@ -82,7 +109,7 @@ void main()
 {
 	extractPosition(aData1, fFragPosition);
 	extractFace(aData1, fFace);
-	extractTexCoords(aData1, aData2, fTexCoords);
+	extractTexCoords(aData1, aData2, fTileCoords, fTileExtent, fTexCoordsOrigin, fTexCoordsU, fTexCoordsV);
 	bool colorVertexByBiome;
 	extractColorVertexBiome(aData2, colorVertexByBiome);
 	extractLightLevel(aData2, fLightLevel);
@@ -106,7 +133,11 @@ void main()
 #version 430 core
 layout (location = 0) out vec4 FragColor;
 
-in vec2 fTexCoords;
+in vec2 fTileCoords;
+flat in vec2 fTileExtent;
+flat in vec2 fTexCoordsOrigin;
+flat in vec2 fTexCoordsU;
+flat in vec2 fTexCoordsV;
 flat in uint fFace;
 in vec3 fFragPosition;
 in vec3 fColor;
@@ -154,7 +185,12 @@ void main()
 	faceToNormal(fFace, normal);
 	float diff = max(dot(normal, lightDir), 0.0);
 
-	vec4 objectColor = texture(uTexture, fTexCoords);
+	// Wrap into the tile, keeping the far edge of the last tile at 1 instead of wrapping it back to 0
+	vec2 tile = fTileCoords - min(floor(fTileCoords), fTileExtent - 1.0);
+	vec2 texCoords = fTexCoordsOrigin + tile.x * fTexCoordsU + tile.y * fTexCoordsV;
+	// The wrapped coordinates jump at every tile edge, so take the gradients from the unwrapped ones
+	vec2 unwrappedTexCoords = fTexCoordsOrigin + fTileCoords.x * fTexCoordsU + fTileCoords.y * fTexCoordsV;
+	vec4 objectColor = textureGrad(uTexture, texCoords, dFdx(unwrappedTexCoords), dFdy(unwrappedTexCoords));
 
 	// Is this very bad for performance??
 	if (objectColor.a < 0.3) 